@@ -55,6 +55,15 @@ namespace
   const long MaxPaddingLegnth = 1024 * 1024;
 
   const char LastBlockFlag = '\x80';
+
+  // Location of a PICTURE block which has not been read yet.
+
+  struct PictureLocation
+  {
+    long offset;
+    unsigned int length;
+    unsigned int blockIndex;
+  };
 }
 
 class FLAC::File::FilePrivate
@@ -89,6 +98,7 @@ public:
   Properties *properties;
   ByteVector xiphCommentData;
   BlockList blocks;
+  List<PictureLocation> pictureLocations;
 
   long flacStart;
   long streamStart;
@@ -167,6 +177,10 @@ bool FLAC::File::save()
     return false;
   }
 
+  // Pictures must be read before the metadata blocks are rewritten
+
+  readPictures();
+
   // Create new vorbis comments
 
   Tag::duplicate(&d->tag, xiphComment(true), false);
@@ -334,6 +348,8 @@ long FLAC::File::streamLength()
 
 List<FLAC::Picture *> FLAC::File::pictureList()
 {
+  readPictures();
+
   List<Picture *> pictures;
   for(BlockConstIterator it = d->blocks.begin(); it != d->blocks.end(); ++it) {
     Picture *picture = dynamic_cast<Picture *>(*it);
@@ -344,13 +360,44 @@ List<FLAC::Picture *> FLAC::File::pictureList()
   return pictures;
 }
 
+bool FLAC::File::firstPictureDataLocation(long &offset, unsigned int &length)
+{
+  if(d->pictureLocations.isEmpty())
+    return false;
+
+  // Skip the fields in front of the data, see FLAC::Picture::parse()
+
+  const PictureLocation &location = d->pictureLocations.front();
+  const long blockEnd = location.offset + static_cast<long>(location.length);
+
+  seek(location.offset + 4);
+  const unsigned int mimeTypeLength = readBlock(4).toUInt();
+  seek(mimeTypeLength, Current);
+  const unsigned int descriptionLength = readBlock(4).toUInt();
+  seek(descriptionLength + 16, Current);
+  const unsigned int dataLength = readBlock(4).toUInt();
+
+  const long dataOffset = tell();
+  if(dataOffset + static_cast<long>(dataLength) > blockEnd) {
+    debug("FLAC::File::firstPictureDataLocation() -- Invalid picture block");
+    return false;
+  }
+
+  offset = dataOffset;
+  length = dataLength;
+  return true;
+}
+
 void FLAC::File::addPicture(Picture *picture)
 {
+  readPictures();
   d->blocks.append(picture);
 }
 
 void FLAC::File::removePicture(Picture *picture, bool del)
 {
+  readPictures();
+
   BlockIterator it = d->blocks.find(picture);
   if(it != d->blocks.end())
     d->blocks.erase(it);
@@ -361,6 +408,8 @@ void FLAC::File::removePicture(Picture *picture, bool del)
 
 void FLAC::File::removePictures()
 {
+  readPictures();
+
   for(BlockIterator it = d->blocks.begin(); it != d->blocks.end(); ) {
     if(dynamic_cast<Picture *>(*it)) {
       delete *it;
@@ -513,6 +562,27 @@ void FLAC::File::scan()
       return;
     }
 
+    // Pictures can be quite large and most callers never need them, so only
+    // remember where they are and read them in readPictures().
+
+    if(blockType == MetadataBlock::Picture) {
+      if(nextBlockOffset + 4 + static_cast<long>(blockLength) > length()) {
+        debug("FLAC::File::scan() -- Failed to read a metadata block");
+        setValid(false);
+        return;
+      }
+
+      const PictureLocation location = { nextBlockOffset + 4, blockLength, d->blocks.size() };
+      d->pictureLocations.append(location);
+
+      nextBlockOffset += blockLength + 4;
+
+      if(isLastBlock)
+        break;
+
+      continue;
+    }
+
     const ByteVector data = readBlock(blockLength);
     if(data.size() != blockLength) {
       debug("FLAC::File::scan() -- Failed to read a metadata block");
@@ -532,16 +602,6 @@ void FLAC::File::scan()
         debug("FLAC::File::scan() -- multiple Vorbis Comment blocks found, discarding");
       }
     }
-    else if(blockType == MetadataBlock::Picture) {
-      FLAC::Picture *picture = new FLAC::Picture();
-      if(picture->parse(data)) {
-        block = picture;
-      }
-      else {
-        debug("FLAC::File::scan() -- invalid picture found, discarding");
-        delete picture;
-      }
-    }
     else if(blockType == MetadataBlock::Padding) {
       // Skip all padding blocks.
     }
@@ -564,3 +624,39 @@ void FLAC::File::scan()
 
   d->scanned = true;
 }
+
+void FLAC::File::readPictures()
+{
+  if(d->pictureLocations.isEmpty())
+    return;
+
+  // Block indexes were recorded before any of the pictures were inserted, so
+  // shift them by the number of pictures already put back into the list.
+
+  unsigned int inserted = 0;
+
+  for(List<PictureLocation>::ConstIterator it = d->pictureLocations.begin(); it != d->pictureLocations.end(); ++it) {
+    seek((*it).offset);
+    const ByteVector data = readBlock((*it).length);
+    if(data.size() != (*it).length) {
+      debug("FLAC::File::readPictures() -- Failed to read a metadata block");
+      continue;
+    }
+
+    FLAC::Picture *picture = new FLAC::Picture();
+    if(!picture->parse(data)) {
+      debug("FLAC::File::readPictures() -- invalid picture found, discarding");
+      delete picture;
+      continue;
+    }
+
+    BlockIterator blockIt = d->blocks.begin();
+    for(unsigned int i = 0; i < (*it).blockIndex + inserted && blockIt != d->blocks.end(); ++i)
+      ++blockIt;
+
+    d->blocks.insert(blockIt, picture);
+    ++inserted;
+  }
+
+  d->pictureLocations.clear();
+}
@@ -260,9 +260,24 @@ namespace TagLib {
 
       /*!
        * Returns a list of pictures attached to the FLAC file.
+       *
+       * \note PICTURE blocks are not read while the file is being scanned,
+       * only their location is recorded.  They are read and parsed on the
+       * first call to this function (or to any other function that touches
+       * the pictures).
        */
       List<Picture *> pictureList();
 
+      /*!
+       * Finds where the picture data of the first PICTURE block is stored in
+       * the file, without reading the picture.  Sets \a offset and \a length
+       * and returns true on success.
+       *
+       * Returns false if the file has no PICTURE blocks, or if the pictures
+       * were already read (pictureList() can be used in that case).
+       */
+      bool firstPictureDataLocation(long &offset, unsigned int &length);
+
       /*!
        * Removes an attached picture. If \a del is true the picture's memory
        * will be freed; if it is false, it must be deleted by the user.
@@ -324,6 +339,7 @@ namespace TagLib {
 
       void read(bool readProperties);
       void scan();
+      void readPictures();
 
       class FilePrivate;
       FilePrivate *d;
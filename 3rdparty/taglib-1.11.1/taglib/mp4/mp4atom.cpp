@@ -37,9 +37,16 @@ const char *MP4::Atom::containers[11] = {
     "stsd"
 };
 
-MP4::Atom::Atom(File *file)
+const char *MP4::Atom::eagerContainers[4] = {
+    "moov", "udta", "meta", "ilst"
+};
+
+MP4::Atom::Atom(File *file) :
+  file(file),
+  headerLength(8),
+  childrenRead(true)
 {
-  children.setAutoDelete(true);
+  childList.setAutoDelete(true);
 
   offset = file->tell();
   ByteVector header = file->readBlock(8);
@@ -80,22 +87,21 @@ MP4::Atom::Atom(File *file)
   }
 
   name = header.mid(4, 4);
+  headerLength = file->tell() - offset;
 
   for(int i = 0; i < numContainers; i++) {
     if(name == containers[i]) {
-      if(name == "meta") {
-        file->seek(4, File::Current);
-      }
-      else if(name == "stsd") {
-        file->seek(8, File::Current);
-      }
-      while(file->tell() < offset + length) {
-        MP4::Atom *child = new MP4::Atom(file);
-        children.append(child);
-        if(child->length == 0)
-          return;
+      childrenRead = false;
+      break;
+    }
+  }
+
+  if(!childrenRead) {
+    for(int i = 0; i < numEagerContainers; i++) {
+      if(name == eagerContainers[i]) {
+        readChildren();
+        return;
       }
-      return;
     }
   }
 
@@ -106,13 +112,58 @@ MP4::Atom::~Atom()
 {
 }
 
+MP4::AtomList &
+MP4::Atom::children()
+{
+  if(!childrenRead) {
+    readChildren();
+  }
+  return childList;
+}
+
+const MP4::AtomList &
+MP4::Atom::loadedChildren() const
+{
+  return childList;
+}
+
+void
+MP4::Atom::readAll()
+{
+  const AtomList &list = children();
+  for(AtomList::ConstIterator it = list.begin(); it != list.end(); ++it) {
+    (*it)->readAll();
+  }
+}
+
+void
+MP4::Atom::readChildren()
+{
+  childrenRead = true;
+
+  file->seek(offset + headerLength);
+  if(name == "meta") {
+    file->seek(4, File::Current);
+  }
+  else if(name == "stsd") {
+    file->seek(8, File::Current);
+  }
+  while(file->tell() < offset + length) {
+    MP4::Atom *child = new MP4::Atom(file);
+    childList.append(child);
+    if(child->length == 0)
+      return;
+  }
+}
+
 MP4::Atom *
 MP4::Atom::find(const char *name1, const char *name2, const char *name3, const char *name4)
 {
   if(name1 == 0) {
     return this;
   }
-  for(AtomList::ConstIterator it = children.begin(); it != children.end(); ++it) {
+  const AtomList &list = children();
+  for(AtomList::ConstIterator it = list.begin(); it != list.end(); ++it) {
     if((*it)->name == name1) {
       return (*it)->find(name2, name3, name4);
     }
@@ -124,7 +175,8 @@ MP4::AtomList
 MP4::Atom::findall(const char *name, bool recursive)
 {
   MP4::AtomList result;
-  for(AtomList::ConstIterator it = children.begin(); it != children.end(); ++it) {
+  const AtomList &list = children();
+  for(AtomList::ConstIterator it = list.begin(); it != list.end(); ++it) {
     if((*it)->name == name) {
       result.append(*it);
     }
@@ -142,7 +194,8 @@ MP4::Atom::path(MP4::AtomList &path, const char *name1, const char *name2, const
   if(name1 == 0) {
     return true;
   }
-  for(AtomList::ConstIterator it = children.begin(); it != children.end(); ++it) {
+  const AtomList &list = children();
+  for(AtomList::ConstIterator it = list.begin(); it != list.end(); ++it) {
     if((*it)->name == name1) {
       return (*it)->path(path, name2, name3);
     }
@@ -169,6 +222,14 @@ MP4::Atoms::~Atoms()
 {
 }
 
+void
+MP4::Atoms::readAll()
+{
+  for(AtomList::ConstIterator it = atoms.begin(); it != atoms.end(); ++it) {
+    (*it)->readAll();
+  }
+}
+
 MP4::Atom *
 MP4::Atoms::find(const char *name1, const char *name2, const char *name3, const char *name4)
 {
@@ -82,13 +82,26 @@ namespace TagLib {
       Atom *find(const char *name1, const char *name2 = 0, const char *name3 = 0, const char *name4 = 0);
       bool path(AtomList &path, const char *name1, const char *name2 = 0, const char *name3 = 0);
       AtomList findall(const char *name, bool recursive = false);
+      // Child atoms are read on first access, except for the atoms leading
+      // to the tag (moov, udta, meta and ilst), which are read right away.
+      AtomList &children();
+      const AtomList &loadedChildren() const;
+      void readAll();
       long offset;
       long length;
       TagLib::ByteVector name;
-      AtomList children;
     private:
+      void readChildren();
+
+      File *file;
+      long headerLength;
+      bool childrenRead;
+      AtomList childList;
+
       static const int numContainers = 11;
       static const char *containers[11];
+      static const int numEagerContainers = 4;
+      static const char *eagerContainers[4];
     };
 
     //! Root-level atoms
@@ -99,6 +112,7 @@ namespace TagLib {
       ~Atoms();
       Atom *find(const char *name1, const char *name2 = 0, const char *name3 = 0, const char *name4 = 0);
       AtomList path(const char *name1, const char *name2 = 0, const char *name3 = 0, const char *name4 = 0);
+      void readAll();
       AtomList atoms;
     };
 
@@ -41,7 +41,7 @@ namespace
       if((*it)->length == 0)
         return false;
 
-      if(!checkValid((*it)->children))
+      if(!checkValid((*it)->loadedChildren()))
         return false;
     }
 
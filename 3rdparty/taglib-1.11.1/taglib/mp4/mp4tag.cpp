@@ -61,7 +61,8 @@ MP4::Tag::Tag(TagLib::File *file, MP4::Atoms *atoms) :
     return;
   }
 
-  for(AtomList::ConstIterator it = ilst->children.begin(); it != ilst->children.end(); ++it) {
+  const AtomList &children = ilst->children();
+  for(AtomList::ConstIterator it = children.begin(); it != children.end(); ++it) {
     MP4::Atom *atom = *it;
     file->seek(atom->offset + 8);
     if(atom->name == "----") {
@@ -500,6 +501,10 @@ MP4::Tag::save()
   }
   data = renderAtom("ilst", data);
 
+  // Atoms outside of the tag are read on demand, but the chunk offsets have
+  // to be known before anything is moved around in the file.
+  d->atoms->readAll();
+
   AtomList path = d->atoms->path("moov", "udta", "meta", "ilst");
   if(path.size() == 4) {
     saveExisting(data, path);
@@ -633,7 +638,7 @@ MP4::Tag::saveNew(ByteVector data)
   // Insert the newly created atoms into the tree to keep it up-to-date.
 
   d->file->seek(offset);
-  path.back()->children.prepend(new Atom(d->file));
+  path.back()->children().prepend(new Atom(d->file));
 }
 
 void
@@ -646,10 +651,11 @@ MP4::Tag::saveExisting(ByteVector data, const AtomList &path)
   long length = ilst->length;
 
   MP4::Atom *meta = *(--it);
-  AtomList::ConstIterator index = meta->children.find(ilst);
+  const AtomList &children = meta->children();
+  AtomList::ConstIterator index = children.find(ilst);
 
   // check if there is an atom before 'ilst', and possibly use it as padding
-  if(index != meta->children.begin()) {
+  if(index != children.begin()) {
     AtomList::ConstIterator prevIndex = index;
     prevIndex--;
     MP4::Atom *prev = *prevIndex;
@@ -661,7 +667,7 @@ MP4::Tag::saveExisting(ByteVector data, const AtomList &path)
   // check if there is an atom after 'ilst', and possibly use it as padding
   AtomList::ConstIterator nextIndex = index;
   nextIndex++;
-  if(nextIndex != meta->children.end()) {
+  if(nextIndex != children.end()) {
     MP4::Atom *next = *nextIndex;
     if(next->name == "free") {
       length += next->length;
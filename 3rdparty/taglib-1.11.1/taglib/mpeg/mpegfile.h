@@ -374,7 +374,7 @@ namespace TagLib {
       File(const File &);
       File &operator=(const File &);
 
-      void read(bool readProperties);
+      void read(bool readProperties, Properties::ReadStyle readStyle);
       long findID3v2();
 
       class FilePrivate;
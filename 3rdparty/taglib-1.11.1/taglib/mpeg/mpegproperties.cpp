@@ -34,6 +34,21 @@
 
 using namespace TagLib;
 
+namespace
+{
+  // Number of frames besides the first one whose bitrate is averaged for
+  // streams without a VBR header.
+  const int bitrateSamples = 4;
+
+  bool isSameStream(const MPEG::Header &first, const MPEG::Header &header)
+  {
+    return header.isValid() &&
+           header.version() == first.version() &&
+           header.layer() == first.layer() &&
+           header.sampleRate() == first.sampleRate();
+  }
+}
+
 class MPEG::Properties::PropertiesPrivate
 {
 public:
@@ -76,7 +91,7 @@ MPEG::Properties::Properties(File *file, ReadStyle style) :
   AudioProperties(style),
   d(new PropertiesPrivate())
 {
-  read(file);
+  read(file, style);
 }
 
 MPEG::Properties::~Properties()
@@ -153,7 +168,7 @@ bool MPEG::Properties::isOriginal() const
 // private members
 ////////////////////////////////////////////////////////////////////////////////
 
-void MPEG::Properties::read(File *file)
+void MPEG::Properties::read(File *file, ReadStyle style)
 {
   // Only the first valid frame is required if we have a VBR header.
 
@@ -198,10 +213,7 @@ void MPEG::Properties::read(File *file)
   else if(firstHeader.bitrate() > 0) {
 
     // Since there was no valid VBR header found, we hope that we're in a constant
-    // bitrate file.
-
-    // TODO: Make this more robust with audio property detection for VBR without a
-    // Xing header.
+    // bitrate file, unless we were asked to look at the rest of the stream.
 
     d->bitrate = firstHeader.bitrate();
 
@@ -226,8 +238,63 @@ void MPEG::Properties::read(File *file)
     }
 
     const long streamLength = lastFrameOffset - firstFrameOffset + lastHeader.frameLength();
-    if(streamLength > 0)
+
+    if(style == Accurate) {
+
+      // Walk through all the frames and count their samples.
+
+      long long samples = 0;
+      long offset = firstFrameOffset;
+      bool synced = true;
+
+      while(offset <= lastFrameOffset) {
+        const Header header(file, offset, !synced);
+        synced = isSameStream(firstHeader, header) && header.frameLength() > 0;
+        if(synced) {
+          samples += header.samplesPerFrame();
+          offset += header.frameLength();
+        }
+        else {
+          offset = file->nextFrameOffset(offset + 1);
+          if(offset < 0)
+            break;
+        }
+      }
+
+      if(samples > 0 && streamLength > 0) {
+        const double length = samples * 1000.0 / firstHeader.sampleRate();
+        d->length  = static_cast<int>(length + 0.5);
+        d->bitrate = static_cast<int>(streamLength * 8.0 / length + 0.5);
+      }
+    }
+    else if(streamLength > 0) {
+
+      // Average the bitrate of a few frames at fixed positions of the stream,
+      // which is enough for the length of a VBR stream to be close.
+
+      if(style == Average) {
+        int bitrates = firstHeader.bitrate();
+        int count = 1;
+
+        for(int i = 1; i <= bitrateSamples; i++) {
+          const long position = static_cast<long>(
+            firstFrameOffset + static_cast<long long>(streamLength) * i / (bitrateSamples + 1));
+          const long offset = file->nextFrameOffset(position);
+          if(offset < 0 || offset >= lastFrameOffset)
+            continue;
+
+          const Header header(file, offset);
+          if(isSameStream(firstHeader, header) && header.bitrate() > 0) {
+            bitrates += header.bitrate();
+            count++;
+          }
+        }
+
+        d->bitrate = static_cast<int>(static_cast<double>(bitrates) / count + 0.5);
+      }
+
       d->length = static_cast<int>(streamLength * 8.0 / d->bitrate + 0.5);
+    }
   }
 
   d->sampleRate        = firstHeader.sampleRate();
@@ -51,6 +51,10 @@ namespace TagLib {
       /*!
        * Create an instance of MPEG::Properties with the data read from the
        * MPEG::File \a file.
+       *
+       * If the stream has no VBR header, its length is calculated from the
+       * bitrate of the first frame with Fast, of a few frames sampled across
+       * the stream with Average, and by walking every frame with Accurate.
        */
       Properties(File *file, ReadStyle style = Average);
 
@@ -141,7 +145,7 @@ namespace TagLib {
       Properties(const Properties &);
       Properties &operator=(const Properties &);
 
-      void read(File *file);
+      void read(File *file, ReadStyle style);
 
       class PropertiesPrivate;
       PropertiesPrivate *d;
@@ -50,12 +50,74 @@ public:
     pictureList.setAutoDelete(true);
   }
 
+  void readPictures();
+
   FieldListMap fieldListMap;
   String vendorID;
   String commentField;
   PictureList pictureList;
+
+  // Base64 encoded picture fields which have not been decoded yet. These
+  // share their data with the buffer passed to parse() instead of copying it.
+  ByteVectorList pictureFields;
 };
 
+void Ogg::XiphComment::XiphCommentPrivate::readPictures()
+{
+  for(ByteVectorList::ConstIterator it = pictureFields.begin(); it != pictureFields.end(); ++it) {
+    const ByteVector &entry = *it;
+
+    if(entry.startsWith("METADATA_BLOCK_PICTURE=")) {
+
+      // Decode base64 picture data
+      ByteVector picturedata = ByteVector::fromBase64(entry.mid(23));
+      if(picturedata.size()) {
+
+        // Decode Flac Picture
+        FLAC::Picture * picture = new FLAC::Picture();
+        if(picture->parse(picturedata)) {
+          pictureList.append(picture);
+          continue;
+        }
+        else {
+          delete picture;
+          debug("Failed to decode FlacPicture block");
+        }
+      }
+      else {
+        debug("Failed to decode base64 encoded data");
+      }
+    }
+    else {
+
+      // Handle old picture standard
+      ByteVector picturedata = ByteVector::fromBase64(entry.mid(9));
+      if(picturedata.size()) {
+
+        // Assume it's some type of image file
+        FLAC::Picture * picture = new FLAC::Picture();
+        picture->setData(picturedata);
+        picture->setMimeType("image/");
+        picture->setType(FLAC::Picture::Other);
+        pictureList.append(picture);
+        continue;
+      }
+      else {
+        debug("Failed to decode base64 encoded data");
+      }
+    }
+
+    // Keep undecodable fields as plain text, as parse() used to do
+    const int sep = entry.find('=');
+    const String key = String(entry.mid(0, sep), String::UTF8);
+    const String value = String(entry.mid(sep + 1), String::UTF8);
+    if(!value.isEmpty())
+      fieldListMap[key.upper()].append(value);
+  }
+
+  pictureFields.clear();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // public members
 ////////////////////////////////////////////////////////////////////////////////
@@ -207,6 +269,7 @@ unsigned int Ogg::XiphComment::fieldCount() const
     count += (*it).second.size();
 
   count += d->pictureList.size();
+  count += d->pictureFields.size();
 
   return count;
 }
@@ -318,6 +381,8 @@ bool Ogg::XiphComment::contains(const String &key) const
 
 void Ogg::XiphComment::removePicture(FLAC::Picture *picture, bool del)
 {
+  d->readPictures();
+
   PictureIterator it = d->pictureList.find(picture);
   if(it != d->pictureList.end())
     d->pictureList.erase(it);
@@ -328,16 +393,19 @@ void Ogg::XiphComment::removePicture(FLAC::Picture *picture, bool del)
 
 void Ogg::XiphComment::removeAllPictures()
 {
+  d->pictureFields.clear();
   d->pictureList.clear();
 }
 
 void Ogg::XiphComment::addPicture(FLAC::Picture * picture)
 {
+  d->readPictures();
   d->pictureList.append(picture);
 }
 
 List<FLAC::Picture *> Ogg::XiphComment::pictureList()
 {
+  d->readPictures();
   return d->pictureList;
 }
 
@@ -348,6 +416,8 @@ ByteVector Ogg::XiphComment::render() const
 
 ByteVector Ogg::XiphComment::render(bool addFramingBit) const
 {
+  d->readPictures();
+
   ByteVector data;
 
   // Add the vendor ID length and the vendor ID.  It's important to use the
@@ -444,33 +514,16 @@ void Ogg::XiphComment::parse(const ByteVector &data)
     if(pos > data.size())
       break;
 
-    // Handle Pictures separately
+    // Handle Pictures separately. Decoding them is deferred until they are
+    // requested, since it is expensive and most of the time not needed.
     if(entry.startsWith("METADATA_BLOCK_PICTURE=")) {
 
       // We need base64 encoded data including padding
       if((entry.size() - 23) > 3 && ((entry.size() - 23) % 4) == 0) {
+        d->pictureFields.append(entry);
 
-        // Decode base64 picture data
-        ByteVector picturedata = ByteVector::fromBase64(entry.mid(23));
-        if(picturedata.size()) {
-
-          // Decode Flac Picture
-          FLAC::Picture * picture = new FLAC::Picture();
-          if(picture->parse(picturedata)) {
-
-            d->pictureList.append(picture);
-
-            // continue to next field
-            continue;
-          }
-          else {
-            delete picture;
-            debug("Failed to decode FlacPicture block");
-          }
-        }
-        else {
-          debug("Failed to decode base64 encoded data");
-        }
+        // continue to next field
+        continue;
       }
       else {
         debug("Invalid base64 encoded data");
@@ -481,24 +534,10 @@ void Ogg::XiphComment::parse(const ByteVector &data)
     if(entry.startsWith("COVERART=")) {
 
       if((entry.size() - 9) > 3 && ((entry.size() - 9) % 4) == 0) {
+        d->pictureFields.append(entry);
 
-        // Decode base64 picture data
-        ByteVector picturedata = ByteVector::fromBase64(entry.mid(9));
-        if (picturedata.size()) {
-
-          // Assume it's some type of image file
-          FLAC::Picture * picture = new FLAC::Picture();
-          picture->setData(picturedata);
-          picture->setMimeType("image/");
-          picture->setType(FLAC::Picture::Other);
-          d->pictureList.append(picture);
-
-          // continue to next field
-          continue;
-        }
-        else {
-          debug("Failed to decode base64 encoded data");
-        }
+        // continue to next field
+        continue;
       }
       else {
         debug("Invalid base64 encoded data");
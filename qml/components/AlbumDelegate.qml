@@ -32,7 +32,7 @@ MediaContainerSelectionDelegate {
         ContextMenu {
             MenuItem {
                 text: qsTranslate("unplayer", "Add to queue")
-                onClicked: Unplayer.Player.queue.addTracks(albumsModel.getTracksForAlbum(albumsProxyModel.sourceIndex(model.index)))
+                onClicked: albumsModel.addTracksForAlbumsToQueue([albumsProxyModel.sourceIndex(model.index)])
             }
 
             MenuItem {
@@ -46,7 +46,7 @@ Page {
                 text: qsTranslate("unplayer", "Add to queue")
 
                 onClicked: {
-                    Unplayer.Player.queue.addTracks(tracksModel.getTracks(tracksProxyModel.selectedSourceIndexes))
+                    tracksModel.addTracksToQueue(tracksProxyModel.selectedSourceIndexes)
                     selectionPanel.showPanel = false
                 }
             }
@@ -54,13 +54,12 @@ Page {
             MenuItem {
                 enabled: tracksProxyModel.hasSelection
                 text: qsTranslate("unplayer", "Add to playlist")
-                onClicked: pageStack.push(addToPlaylistPage)
+                onClicked: tracksModel.getTracks(tracksProxyModel.selectedSourceIndexes)
 
                 Component {
                     id: addToPlaylistPage
 
                     AddToPlaylistPage {
-                        tracks: tracksModel.getTracks(tracksProxyModel.selectedSourceIndexes)
                         Component.onDestruction: {
                             if (added) {
                                 selectionPanel.showPanel = false
@@ -90,6 +89,7 @@ Page {
             filterRole: Unplayer.TracksModel.TitleRole
             sourceModel: Unplayer.TracksModel {
                 id: tracksModel
+                onGotTracks: pageStack.push(addToPlaylistPage, { tracks: tracks })
 
                 allArtists: false
                 allAlbums: false
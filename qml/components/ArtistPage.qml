@@ -44,7 +44,7 @@ Page {
                 enabled: albumsProxyModel.hasSelection
                 text: qsTranslate("unplayer", "Add to queue")
                 onClicked: {
-                    Unplayer.Player.queue.addTracks(albumsModel.getTracksForAlbums(albumsProxyModel.selectedSourceIndexes))
+                    albumsModel.addTracksForAlbumsToQueue(albumsProxyModel.selectedSourceIndexes)
                     selectionPanel.showPanel = false
                 }
             }
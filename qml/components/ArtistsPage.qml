@@ -35,7 +35,7 @@ Page {
                 enabled: artistsProxyModel.hasSelection
                 text: qsTranslate("unplayer", "Add to queue")
                 onClicked: {
-                    Unplayer.Player.queue.addTracks(artistsModel.getTracksForArtists(artistsProxyModel.selectedSourceIndexes))
+                    artistsModel.addTracksForArtistsToQueue(artistsProxyModel.selectedSourceIndexes)
                     selectionPanel.showPanel = false
                 }
             }
@@ -91,7 +91,7 @@ Page {
 
                     MenuItem {
                         text: qsTranslate("unplayer", "Add to queue")
-                        onClicked: Unplayer.Player.queue.addTracks(artistsModel.getTracksForArtist(artistsProxyModel.sourceIndex(model.index)))
+                        onClicked: artistsModel.addTracksForArtistsToQueue([artistsProxyModel.sourceIndex(model.index)])
                     }
 
                     MenuItem {
@@ -52,7 +52,7 @@ BaseTrackDelegate {
                     Unplayer.Player.play()
                 }
             } else {
-                Unplayer.Player.queue.addTracks(tracksModel.getTracks(tracksProxyModel.sourceIndexes), true, model.index)
+                tracksModel.addTracksToQueue(tracksProxyModel.sourceIndexes, true, model.index)
             }
         }
     }
@@ -50,16 +50,26 @@ DockedPanel {
 
     BusyIndicator {
         anchors.centerIn: parent
-        running: Unplayer.Player.queue.addingTracks
+        running: Unplayer.Player.queue.addingTracks && Unplayer.Player.queue.currentIndex === -1
         size: BusyIndicatorSize.Medium
     }
 
+    Rectangle {
+        anchors.bottom: parent.bottom
+        height: Theme.paddingSmall
+        width: parent.width * Unplayer.Player.queue.addingTracksProgress
+        z: 1
+        color: Theme.highlightColor
+        opacity: 0.5
+        visible: Unplayer.Player.queue.addingTracks
+    }
+
     BackgroundItem {
         id: pressItem
 
         anchors.fill: parent
 
-        enabled: !Unplayer.Player.queue.addingTracks
+        enabled: Unplayer.Player.queue.currentIndex !== -1
         opacity: enabled ? 1 : 0
         Behavior on opacity { FadeAnimation { } }
 
@@ -25,6 +25,8 @@ DockedPanel {
     id: searchPanel
 
     property string searchText: searchField.text.trim()
+    // Set to false when the model searches by itself using searchText
+    property bool filterModel: true
 
     function focusSearchField() {
         searchField.forceActiveFocus()
@@ -67,7 +69,11 @@ DockedPanel {
             }
             enabled: open
 
-            onTextChanged: listView.model.filterRegExp = new RegExp(Unplayer.Utils.escapeRegExp(text.trim()), "i")
+            onTextChanged: {
+                if (filterModel) {
+                    listView.model.filterText = text.trim()
+                }
+            }
         }
 
         IconButton {
@@ -74,6 +74,12 @@ Page {
                 Component.onCompleted: checked = Unplayer.Settings.openLibraryOnStartup
             }
 
+            TextSwitch {
+                text: qsTranslate("unplayer", "Calculate exact duration of MP3 files without VBR header in background")
+                onCheckedChanged: Unplayer.Settings.accurateDuration = checked
+                Component.onCompleted: checked = Unplayer.Settings.accurateDuration
+            }
+
             BackgroundItem {
                 id: libraryDirectoriesItem
 
@@ -30,6 +30,7 @@ Page {
 
     SearchPanel {
         id: searchPanel
+        filterModel: false
     }
 
     SelectionPanel {
@@ -41,7 +42,7 @@ Page {
                 enabled: tracksProxyModel.hasSelection
                 text: qsTranslate("unplayer", "Add to queue")
                 onClicked: {
-                    Unplayer.Player.queue.addTracks(tracksModel.getTracks(tracksProxyModel.selectedSourceIndexes))
+                    tracksModel.addTracksToQueue(tracksProxyModel.selectedSourceIndexes)
                     selectionPanel.showPanel = false
                 }
             }
@@ -49,13 +50,12 @@ Page {
             MenuItem {
                 enabled: tracksProxyModel.hasSelection
                 text: qsTranslate("unplayer", "Add to playlist")
-                onClicked: pageStack.push(addToPlaylistPage)
+                onClicked: tracksModel.getTracks(tracksProxyModel.selectedSourceIndexes)
 
                 Component {
                     id: addToPlaylistPage
 
                     AddToPlaylistPage {
-                        tracks: tracksModel.getTracks(tracksProxyModel.selectedSourceIndexes)
                         Component.onDestruction: {
                             if (added) {
                                 selectionPanel.showPanel = false
@@ -90,7 +90,9 @@ Page {
             filterRole: Unplayer.TracksModel.TitleRole
             sourceModel: Unplayer.TracksModel {
                 id: tracksModel
+                onGotTracks: pageStack.push(addToPlaylistPage, { tracks: tracks })
                 allAlbums: true
+                searchQuery: searchPanel.searchText
             }
         }
         section {
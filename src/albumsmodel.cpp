@@ -19,9 +19,10 @@
 #include "albumsmodel.h"
 
 #include <QCoreApplication>
-#include <QDebug>
-#include <QSqlError>
 
+#include "libraryutils.h"
+#include "player.h"
+#include "queue.h"
 #include "settings.h"
 #include "utils.h"
 
@@ -40,7 +41,13 @@ namespace unplayer
     }
 
     AlbumsModel::AlbumsModel()
-        : mAllArtists(true)
+        : DatabaseModel({FieldType::String,
+                         FieldType::String,
+                         FieldType::Int,
+                         FieldType::Int,
+                         FieldType::Int},
+                        {ArtistField, AlbumField}),
+          mAllArtists(true)
     {
 
     }
@@ -71,39 +78,41 @@ namespace unplayer
 
     QVariant AlbumsModel::data(const QModelIndex& index, int role) const
     {
-        mQuery->seek(index.row());
+        const int row = index.row();
 
         switch (role) {
         case ArtistRole:
-            return mQuery->value(ArtistField);
+            return stringValue(row, ArtistField);
         case DisplayedArtistRole:
         {
-            const QString artist(mQuery->value(ArtistField).toString());
+            const QString& artist = stringValue(row, ArtistField);
             if (artist.isEmpty()) {
-                return qApp->translate("unplayer", "Unknown artist");
+                static const QString unknownArtist(qApp->translate("unplayer", "Unknown artist"));
+                return unknownArtist;
             }
             return artist;
         }
         case UnknownArtistRole:
-            return mQuery->value(ArtistField).toString().isEmpty();
+            return stringValue(row, ArtistField).isEmpty();
         case AlbumRole:
-            return mQuery->value(AlbumField);
+            return stringValue(row, AlbumField);
         case DisplayedAlbumRole:
         {
-            const QString album(mQuery->value(AlbumField).toString());
+            const QString& album = stringValue(row, AlbumField);
             if (album.isEmpty()) {
-                return qApp->translate("unplayer", "Unknown album");
+                static const QString unknownAlbum(qApp->translate("unplayer", "Unknown album"));
+                return unknownAlbum;
             }
             return album;
         }
         case UnknownAlbumRole:
-            return mQuery->value(AlbumField).toString().isEmpty();
+            return stringValue(row, AlbumField).isEmpty();
         case YearRole:
-            return mQuery->value(YearField).toInt();
+            return intValue(row, YearField);
         case TracksCountRole:
-            return mQuery->value(TracksCountField);
+            return intValue(row, TracksCountField);
         case DurationRole:
-            return mQuery->value(DurationField);
+            return intValue(row, DurationField);
         default:
             return QVariant();
         }
@@ -159,34 +168,20 @@ namespace unplayer
 
     QStringList AlbumsModel::getTracksForAlbum(int index) const
     {
-        QSqlQuery query;
-        query.prepare(QStringLiteral("SELECT filePath FROM tracks "
-                                     "WHERE artist = ? AND album = ? "
-                                     "ORDER BY trackNumber, title"));
-        mQuery->seek(index);
-        query.addBindValue(mQuery->value(ArtistField).toString());
-        query.addBindValue(mQuery->value(AlbumField).toString());
-        if (query.exec()) {
-            QStringList tracks;
-            while (query.next()) {
-                tracks.append(query.value(0).toString());
-            }
-            return tracks;
-        }
-
-        qWarning() << "failed to get tracks from database" << query.lastError();
-        return QStringList();
+        return getTracksForAlbums({index});
     }
 
     QStringList AlbumsModel::getTracksForAlbums(const QVector<int>& indexes) const
     {
-        QStringList tracks;
-        QSqlDatabase::database().transaction();
-        for (int index : indexes) {
-            tracks.append(getTracksForAlbum(index));
-        }
-        QSqlDatabase::database().commit();
-        return tracks;
+        return filePaths(getTracksForSelection(selectedAlbums(indexes)));
+    }
+
+    void AlbumsModel::addTracksForAlbumsToQueue(const QVector<int>& indexes) const
+    {
+        const QVector<QStringList> selection(selectedAlbums(indexes));
+        Player::instance()->queue()->addLibraryTracks([selection]() {
+            return getTracksForSelection(selection);
+        });
     }
 
     QHash<int, QByteArray> AlbumsModel::roleNames() const
@@ -202,41 +197,56 @@ namespace unplayer
                 {DurationRole, "duration"}};
     }
 
+    QVector<QStringList> AlbumsModel::selectedAlbums(const QVector<int>& indexes) const
+    {
+        QVector<QStringList> selection;
+        selection.reserve(indexes.size());
+        for (int index : indexes) {
+            selection.append({stringValue(index, ArtistField), stringValue(index, AlbumField)});
+        }
+        return selection;
+    }
+
+    QVector<LibraryTrack> AlbumsModel::getTracksForSelection(const QVector<QStringList>& selection)
+    {
+        return getLibraryTracks({QLatin1String("artist"), QLatin1String("album")},
+                                selection,
+                                QLatin1String("genreIndex = 0"),
+                                QLatin1String("trackNumber, titleSortKey"));
+    }
+
     void AlbumsModel::setQuery()
     {
-        QString query(QLatin1String("SELECT artist, album, year, COUNT(*), SUM(duration) FROM "
-                                    "(SELECT artist, album, year, duration FROM tracks GROUP BY id, artist, album) "));
+        QString query(QLatin1String("SELECT artist, album, year, COUNT(*), SUM(duration) FROM tracks "));
         if (mAllArtists) {
-            query += QLatin1String("GROUP BY album, artist ");
+            query += QLatin1String("WHERE genreIndex = 0 "
+                                   "GROUP BY album, artist ");
         } else {
-            query += QLatin1String("WHERE artist = ? "
+            query += QLatin1String("WHERE genreIndex = 0 AND artist = ? "
                                    "GROUP BY album ");
         }
 
         switch (mSortMode) {
         case SortAlbum:
-            query += QLatin1String("ORDER BY album = '' %1, album %1");
+            query += QLatin1String("ORDER BY albumSortKey %1");
             break;
         case SortYear:
-            query += QLatin1String("ORDER BY year %1, album = '' %1, album %1");
+            query += QLatin1String("ORDER BY year %1, albumSortKey %1");
             break;
         case SortArtistAlbum:
-            query += QLatin1String("ORDER BY artist = '' %1, artist %1, album = '' %1, album %1");
+            query += QLatin1String("ORDER BY artistSortKey %1, albumSortKey %1");
             break;
         case SortArtistYear:
-            query += QLatin1String("ORDER BY artist = '' %1, artist %1, year %1, album = '' %1, album %1");
+            query += QLatin1String("ORDER BY artistSortKey %1, year %1, albumSortKey %1");
         }
 
         query = query.arg(mSortDescending ? QLatin1String("DESC")
                                           : QLatin1String("ASC"));
 
-
-        beginResetModel();
-        mQuery->prepare(query);
+        QVariantList bindValues;
         if (!mAllArtists) {
-            mQuery->addBindValue(mArtist);
+            bindValues.append(mArtist);
         }
-        execQuery();
-        endResetModel();
+        execQuery(query, bindValues);
     }
 }
@@ -76,12 +76,17 @@ namespace unplayer
 
         Q_INVOKABLE QStringList getTracksForAlbum(int index) const;
         Q_INVOKABLE QStringList getTracksForAlbums(const QVector<int>& indexes) const;
+        // Tracks are selected in a worker thread
+        Q_INVOKABLE void addTracksForAlbumsToQueue(const QVector<int>& indexes) const;
 
     protected:
         QHash<int, QByteArray> roleNames() const override;
 
     private:
-        void setQuery();
+        void setQuery() override;
+
+        QVector<QStringList> selectedAlbums(const QVector<int>& indexes) const;
+        static QVector<LibraryTrack> getTracksForSelection(const QVector<QStringList>& selection);
 
         bool mAllArtists;
         QString mArtist;
@@ -19,9 +19,10 @@
 #include "artistsmodel.h"
 
 #include <QCoreApplication>
-#include <QDebug>
-#include <QSqlError>
 
+#include "libraryutils.h"
+#include "player.h"
+#include "queue.h"
 #include "settings.h"
 
 namespace unplayer
@@ -38,32 +39,38 @@ namespace unplayer
     }
 
     ArtistsModel::ArtistsModel()
-        : mSortDescending(Settings::instance()->artistsSortDescending())
+        : DatabaseModel({FieldType::String,
+                         FieldType::Int,
+                         FieldType::Int,
+                         FieldType::Int},
+                        {ArtistField}),
+          mSortDescending(Settings::instance()->artistsSortDescending())
     {
         setQuery();
     }
 
     QVariant ArtistsModel::data(const QModelIndex& index, int role) const
     {
-        mQuery->seek(index.row());
+        const int row = index.row();
 
         switch (role) {
         case ArtistRole:
-            return mQuery->value(ArtistField).toString();
+            return stringValue(row, ArtistField);
         case DisplayedArtistRole:
         {
-            const QString artist(mQuery->value(ArtistField).toString());
+            const QString& artist = stringValue(row, ArtistField);
             if (artist.isEmpty()) {
-                return qApp->translate("unplayer", "Unknown artist");
+                static const QString unknownArtist(qApp->translate("unplayer", "Unknown artist"));
+                return unknownArtist;
             }
             return artist;
         }
         case AlbumsCountRole:
-            return mQuery->value(AlbumsCountField);
+            return intValue(row, AlbumsCountField);
         case TracksCountRole:
-            return mQuery->value(TracksCountField);
+            return intValue(row, TracksCountField);
         case DurationRole:
-            return mQuery->value(DurationField);
+            return intValue(row, DurationField);
         default:
             return QVariant();
         }
@@ -84,33 +91,20 @@ namespace unplayer
 
     QStringList ArtistsModel::getTracksForArtist(int index) const
     {
-        QSqlQuery query;
-        query.prepare(QStringLiteral("SELECT filePath FROM tracks "
-                                     "WHERE artist = ? "
-                                     "ORDER BY album = '', year, album, trackNumber, title"));
-        mQuery->seek(index);
-        query.addBindValue(mQuery->value(ArtistField).toString());
-        if (query.exec()) {
-            QStringList tracks;
-            while (query.next()) {
-                tracks.append(query.value(0).toString());
-            }
-            return tracks;
-        }
-
-        qWarning() << "failed to get tracks from database" << query.lastError();
-        return QStringList();
+        return getTracksForArtists({index});
     }
 
     QStringList ArtistsModel::getTracksForArtists(const QVector<int>& indexes) const
     {
-        QStringList tracks;
-        QSqlDatabase::database().transaction();
-        for (int index : indexes) {
-            tracks.append(getTracksForArtist(index));
-        }
-        QSqlDatabase::database().commit();
-        return tracks;
+        return filePaths(getTracksForSelection(selectedArtists(indexes)));
+    }
+
+    void ArtistsModel::addTracksForArtistsToQueue(const QVector<int>& indexes) const
+    {
+        const QVector<QStringList> selection(selectedArtists(indexes));
+        Player::instance()->queue()->addLibraryTracks([selection]() {
+            return getTracksForSelection(selection);
+        });
     }
 
     QHash<int, QByteArray> ArtistsModel::roleNames() const
@@ -122,15 +116,30 @@ namespace unplayer
                 {DurationRole, "duration"}};
     }
 
+    QVector<QStringList> ArtistsModel::selectedArtists(const QVector<int>& indexes) const
+    {
+        QVector<QStringList> selection;
+        selection.reserve(indexes.size());
+        for (int index : indexes) {
+            selection.append({stringValue(index, ArtistField)});
+        }
+        return selection;
+    }
+
+    QVector<LibraryTrack> ArtistsModel::getTracksForSelection(const QVector<QStringList>& selection)
+    {
+        return getLibraryTracks({QLatin1String("artist")},
+                                selection,
+                                QLatin1String("genreIndex = 0"),
+                                QLatin1String("album = '', year, albumSortKey, trackNumber, titleSortKey"));
+    }
+
     void ArtistsModel::setQuery()
     {
-        beginResetModel();
-        mQuery->prepare(QString::fromLatin1("SELECT artist, COUNT(DISTINCT(album)), COUNT(*), SUM(duration) FROM "
-                                            "(SELECT artist, album, duration FROM tracks GROUP BY id, artist, album) "
-                                            "GROUP BY artist "
-                                            "ORDER BY artist = '' %1, artist %1").arg(mSortDescending ? QLatin1String("DESC")
-                                                                                                      : QLatin1String("ASC")));
-        execQuery();
-        endResetModel();
+        execQuery(QString::fromLatin1("SELECT artist, COUNT(DISTINCT(album)), COUNT(*), SUM(duration) FROM tracks "
+                                      "WHERE genreIndex = 0 "
+                                      "GROUP BY artist "
+                                      "ORDER BY artistSortKey %1").arg(mSortDescending ? QLatin1String("DESC")
+                                                                                       : QLatin1String("ASC")));
     }
 }
@@ -48,11 +48,16 @@ namespace unplayer
 
         Q_INVOKABLE QStringList getTracksForArtist(int index) const;
         Q_INVOKABLE QStringList getTracksForArtists(const QVector<int>& indexes) const;
+        // Tracks are selected in a worker thread
+        Q_INVOKABLE void addTracksForArtistsToQueue(const QVector<int>& indexes) const;
     protected:
         QHash<int, QByteArray> roleNames() const override;
 
     private:
-        void setQuery();
+        void setQuery() override;
+
+        QVector<QStringList> selectedArtists(const QVector<int>& indexes) const;
+        static QVector<LibraryTrack> getTracksForSelection(const QVector<QStringList>& selection);
 
         bool mSortDescending;
 
@@ -18,16 +18,109 @@
 
 #include "databasemodel.h"
 
+#include <algorithm>
+#include <cstdlib>
+
 #include <QDebug>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QMap>
+#include <QMutexLocker>
+#include <QSqlDatabase>
 #include <QSqlError>
+#include <QSqlQuery>
+#include <QtConcurrentRun>
+
+#include "libraryutils.h"
 
 namespace unplayer
 {
-    DatabaseModel::DatabaseModel()
-        : mQuery(new QSqlQuery()),
-          mRowCount(0)
+    namespace
+    {
+        // Rows are handed over to the model in batches of this size, first
+        // batch is sent as soon as it is read
+        const int rowsBatchSize = 256;
+
+        const int pageSize = 128;
+        const int maxPagesCount = 8;
+
+        // More moved rows than this (e.g. when sort order is changed) reset the model
+        const int maxMovedRowsCount = 100;
+
+        // Marks values that are members of a longest strictly increasing subsequence
+        QVector<bool> longestIncreasingSubsequence(const QVector<int>& values)
+        {
+            // Index of the last value of best subsequence of each length, and previous value of each value
+            QVector<int> tails;
+            QVector<int> previous(values.size(), -1);
+            for (int i = 0, max = values.size(); i < max; ++i) {
+                const auto tail = std::lower_bound(tails.begin(), tails.end(), values.at(i), [&](int index, int value) {
+                    return values.at(index) < value;
+                });
+                if (tail != tails.begin()) {
+                    previous[i] = *(tail - 1);
+                }
+                if (tail == tails.end()) {
+                    tails.append(i);
+                } else {
+                    *tail = i;
+                }
+            }
+
+            QVector<bool> members(values.size(), false);
+            for (int i = tails.isEmpty() ? -1 : tails.last(); i != -1; i = previous.at(i)) {
+                members[i] = true;
+            }
+            return members;
+        }
+    }
+
+    struct DatabaseModel::QueryState
+    {
+        QMutex mutex;
+        bool cancelled = false;
+        bool finished = false;
+        // rowsRead() is emitted and rows are not taken yet
+        bool notified = false;
+        // Rows that are read but not inserted in the model yet
+        Rows rows;
+    };
+
+    struct DatabaseModel::Page
     {
+        Rows rows;
+        // Sort keys of the last row, empty if page wasn't read completely
+        QVariantList endKeys;
+    };
 
+    struct DatabaseModel::PagedQueryResult
+    {
+        int count = 0;
+        // Pages that were loaded when query was executed, read again
+        QMap<int, Page> pages;
+    };
+
+    DatabaseModel::DatabaseModel(const QVector<FieldType>& fieldTypes, const QVector<int>& keyFields)
+        : mRowCount(0),
+          mFieldTypes(fieldTypes),
+          mKeyFields(keyFields),
+          mQueryExecuted(false),
+          mDiffing(false),
+          mPaged(false),
+          mPagedQueryGeneration(0),
+          mRefreshingPages(false)
+    {
+        QObject::connect(this, &DatabaseModel::rowsRead, this, &DatabaseModel::insertReadRows, Qt::QueuedConnection);
+        QObject::connect(LibraryUtils::instance(), &LibraryUtils::databaseChanged, this, [=]() {
+            if (mQueryExecuted) {
+                setQuery();
+            }
+        });
+    }
+
+    DatabaseModel::~DatabaseModel()
+    {
+        cancelQuery();
     }
 
     void DatabaseModel::classBegin()
@@ -45,13 +138,889 @@ namespace unplayer
         return mRowCount;
     }
 
-    void DatabaseModel::execQuery()
+    void DatabaseModel::execQuery(const QString& query, const QVariantList& bindValues)
     {
-        if (mQuery->exec()) {
-            mQuery->last();
-            mRowCount = mQuery->at() + 1;
+        // Previous rows are complete only if their query is finished
+        mDiffing = (!mPaged && !mQueryState && mRowCount > 0);
+
+        cancelQuery();
+        mQueryExecuted = true;
+
+        if (mDiffing) {
+            mNewRows.columns = QVector<QVector<int>>(mFieldTypes.size());
+            mNewRows.strings = {QString()};
         } else {
-            qWarning() << mQuery->lastError();
+            beginResetModel();
+            mRows.columns = QVector<QVector<int>>(mFieldTypes.size());
+            // Empty string (and NULL) is always first
+            mRows.strings = {QString()};
+            mRowCount = 0;
+            mPaged = false;
+            mPages.clear();
+            mPageEndKeys.clear();
+            mLoadingPages.clear();
+            ++mPagedQueryGeneration;
+            mRefreshingPages = false;
+            mEmptyPage = Rows();
+            mNewRows = Rows();
+            endResetModel();
+        }
+
+        const std::shared_ptr<QueryState> state(std::make_shared<QueryState>());
+        mQueryState = state;
+
+        const QVector<FieldType> fieldTypes(mFieldTypes);
+
+        QtConcurrent::run([=]() {
+            const QSqlDatabase db(LibraryUtils::readOnlyDatabase());
+            if (!db.isOpen()) {
+                return;
+            }
+
+            QSqlQuery sqlQuery(db);
+            sqlQuery.setForwardOnly(true);
+            sqlQuery.prepare(query);
+            for (const QVariant& value : bindValues) {
+                sqlQuery.addBindValue(value);
+            }
+
+            if (sqlQuery.exec()) {
+                QHash<QString, int> stringIndexes{{QString(), 0}};
+
+                Rows rows;
+                rows.columns.resize(fieldTypes.size());
+                int batchRowCount = 0;
+
+                const auto handOver = [&](bool last) {
+                    QMutexLocker locker(&state->mutex);
+                    if (state->cancelled) {
+                        return false;
+                    }
+                    if (state->rows.columns.isEmpty()) {
+                        state->rows = std::move(rows);
+                    } else {
+                        state->rows.strings += rows.strings;
+                        for (int field = 0, fieldsCount = fieldTypes.size(); field < fieldsCount; ++field) {
+                            state->rows.columns[field] += rows.columns.at(field);
+                        }
+                    }
+                    state->finished = last;
+                    if (!state->notified) {
+                        state->notified = true;
+                        emit rowsRead(QPrivateSignal());
+                    }
+                    rows = Rows();
+                    rows.columns.resize(fieldTypes.size());
+                    batchRowCount = 0;
+                    return true;
+                };
+
+                bool cancelled = false;
+                while (sqlQuery.next()) {
+                    appendRow(sqlQuery, fieldTypes, stringIndexes, rows);
+
+                    ++batchRowCount;
+                    if (batchRowCount == rowsBatchSize && !handOver(false)) {
+                        cancelled = true;
+                        break;
+                    }
+                }
+
+                if (!cancelled) {
+                    handOver(true);
+                }
+            } else {
+                qWarning() << sqlQuery.lastError();
+            }
+        });
+    }
+
+    void DatabaseModel::execPagedQuery(const PagedQuery& query)
+    {
+        cancelQuery();
+        mQueryExecuted = true;
+        mDiffing = false;
+        mNewRows = Rows();
+
+        if (!mPaged) {
+            beginResetModel();
+            mRows = Rows();
+            mPaged = true;
+            mPages.clear();
+            mRowCount = 0;
+            mEmptyPage.strings = {QString()};
+            mEmptyPage.columns = QVector<QVector<int>>(mFieldTypes.size(), QVector<int>(pageSize, 0));
+            endResetModel();
+        }
+
+        // Loaded pages are shown until they are read again with new query,
+        // end keys of pages that are not loaded are not valid anymore
+        mPagedQuery = query;
+        mPageEndKeys.clear();
+        mLoadingPages.clear();
+        mRefreshingPages = true;
+
+        const int generation = ++mPagedQueryGeneration;
+        const QVector<FieldType> fieldTypes(mFieldTypes);
+        QList<int> pages(mPages.keys());
+        std::sort(pages.begin(), pages.end());
+
+        auto future = QtConcurrent::run([query, fieldTypes, pages]() {
+            PagedQueryResult result;
+
+            QString countQueryString(QString::fromLatin1("SELECT COUNT(*) FROM (SELECT 1 FROM %1 ").arg(query.table));
+            if (!query.where.isEmpty()) {
+                countQueryString += QString::fromLatin1("WHERE %1 ").arg(query.where);
+            }
+            if (!query.groupBy.isEmpty()) {
+                countQueryString += QString::fromLatin1("GROUP BY %1").arg(query.groupBy);
+            }
+            countQueryString += QLatin1Char(')');
+
+            const QSqlDatabase db(LibraryUtils::readOnlyDatabase());
+            if (!db.isOpen()) {
+                return result;
+            }
+
+            QSqlQuery countQuery(db);
+            countQuery.prepare(countQueryString);
+            for (const QVariant& value : query.bindValues) {
+                countQuery.addBindValue(value);
+            }
+            if (countQuery.exec() && countQuery.next()) {
+                result.count = countQuery.value(0).toInt();
+            } else {
+                qWarning() << "failed to get rows count" << countQuery.lastError();
+                return result;
+            }
+
+            // Pages are read in order, so that each one can continue from the previous one
+            QVariantList previousEndKeys;
+            int previousPage = -1;
+            for (int page : pages) {
+                const int pageRowCount = std::min(pageSize, result.count - page * pageSize);
+                if (pageRowCount <= 0) {
+                    break;
+                }
+                Page loaded(readPage(query, fieldTypes, page, pageRowCount, page == previousPage + 1 ? previousEndKeys : QVariantList()));
+                previousEndKeys = loaded.endKeys;
+                previousPage = page;
+                result.pages.insert(page, std::move(loaded));
+            }
+
+            return result;
+        });
+
+        using FutureWatcher = QFutureWatcher<PagedQueryResult>;
+        auto watcher = new FutureWatcher(this);
+        QObject::connect(watcher, &FutureWatcher::finished, this, [=]() {
+            watcher->deleteLater();
+            if (generation == mPagedQueryGeneration) {
+                applyPagedQueryResult(watcher->result());
+            }
+        });
+        watcher->setFuture(future);
+    }
+
+    const QString& DatabaseModel::stringValue(int row, int field) const
+    {
+        int rowInRows;
+        const Rows& rows = rowsForRow(row, rowInRows);
+        return rows.strings.at(rows.columns.at(field).at(rowInRows));
+    }
+
+    int DatabaseModel::intValue(int row, int field) const
+    {
+        int rowInRows;
+        return rowsForRow(row, rowInRows).columns.at(field).at(rowInRows);
+    }
+
+    std::function<QVector<QVariantList>()> DatabaseModel::rowsValues(const QVector<int>& rows, const QVector<int>& fields) const
+    {
+        QVector<QVariantList> values(rows.size());
+
+        if (!mPaged) {
+            for (int i = 0, max = rows.size(); i < max; ++i) {
+                for (int field : fields) {
+                    values[i].append(fieldValue(mRows, mFieldTypes, rows.at(i), field));
+                }
+            }
+            return [values]() {
+                return values;
+            };
+        }
+
+        // Positions in rows of rows whose pages are not loaded, by page
+        QMap<int, QVector<int>> missingPages;
+        for (int i = 0, max = rows.size(); i < max; ++i) {
+            const int row = rows.at(i);
+            const auto found(mPages.constFind(row / pageSize));
+            if (found == mPages.constEnd()) {
+                missingPages[row / pageSize].append(i);
+            } else {
+                for (int field : fields) {
+                    values[i].append(fieldValue(found.value(), mFieldTypes, row % pageSize, field));
+                }
+            }
+        }
+
+        if (missingPages.isEmpty()) {
+            return [values]() {
+                return values;
+            };
+        }
+
+        const PagedQuery query(mPagedQuery);
+        const QVector<FieldType> fieldTypes(mFieldTypes);
+        const int rowCount = mRowCount;
+        const QHash<int, QVariantList> pageEndKeys(mPageEndKeys);
+        return [=]() {
+            QVector<QVariantList> result(values);
+            QHash<int, QVariantList> endKeys(pageEndKeys);
+            // Pages are read in order, so that each one can continue from the previous one
+            for (auto i = missingPages.cbegin(), end = missingPages.cend(); i != end; ++i) {
+                const int page = i.key();
+                const Page loaded(readPage(query, fieldTypes, page, std::min(pageSize, rowCount - page * pageSize), endKeys.value(page - 1)));
+                if (!loaded.endKeys.isEmpty()) {
+                    endKeys.insert(page, loaded.endKeys);
+                }
+                for (int position : i.value()) {
+                    for (int field : fields) {
+                        result[position].append(fieldValue(loaded.rows, fieldTypes, rows.at(position) % pageSize, field));
+                    }
+                }
+            }
+            return result;
+        };
+    }
+
+    QVector<LibraryTrack> DatabaseModel::getLibraryTracks(const QStringList& keyColumns,
+                                                          const QVector<QStringList>& selection,
+                                                          const QString& where,
+                                                          const QString& orderBy)
+    {
+        QStringList selectionColumns{QLatin1String("position")};
+        QStringList joinConditions;
+        QString rowPlaceholder(QLatin1String("(?"));
+        for (int i = 0, max = keyColumns.size(); i < max; ++i) {
+            const QString column(QString::fromLatin1("key%1").arg(i));
+            selectionColumns.append(column);
+            joinConditions.append(QString::fromLatin1("tracks.%1 = selection.%2").arg(keyColumns.at(i), column));
+            rowPlaceholder += QLatin1String(", ?");
+        }
+        rowPlaceholder += QLatin1Char(')');
+
+        // Keep bound values of each query under default SQLite limit
+        const int chunkSize = 999 / selectionColumns.size();
+
+        QVector<LibraryTrack> tracks;
+        const QSqlDatabase db(LibraryUtils::readOnlyDatabase());
+        for (int chunkStart = 0, selectionSize = selection.size(); chunkStart < selectionSize; chunkStart += chunkSize) {
+            const int chunkEnd = std::min(chunkStart + chunkSize, selectionSize);
+
+            QStringList rows;
+            rows.reserve(chunkEnd - chunkStart);
+            for (int i = chunkStart; i < chunkEnd; ++i) {
+                rows.append(rowPlaceholder);
+            }
+
+            // Matched row is joined with all rows of its track to get all artists and albums.
+            // Their columns are renamed so that where and orderBy can use unqualified names
+            QString queryString(QString::fromLatin1("WITH selection(%1) AS (VALUES %2) "
+                                                    "SELECT tracks.rowid, tracks.id, tracks.filePath, tracks.modificationTime, tracks.title, tracks.duration, tracks.mediaArt, "
+                                                    "trackRows.trackArtist, trackRows.trackAlbum "
+                                                    "FROM tracks JOIN selection ON %3 "
+                                                    "JOIN (SELECT id AS trackId, artist AS trackArtist, album AS trackAlbum FROM tracks WHERE genreIndex = 0) AS trackRows "
+                                                    "ON trackRows.trackId = tracks.id ")
+                                .arg(selectionColumns.join(QLatin1String(", ")),
+                                     rows.join(QLatin1String(", ")),
+                                     joinConditions.join(QLatin1String(" AND "))));
+            if (!where.isEmpty()) {
+                queryString += QLatin1String("WHERE ") + where + QLatin1Char(' ');
+            }
+            queryString += QLatin1String("ORDER BY selection.position, ");
+            if (!orderBy.isEmpty()) {
+                queryString += orderBy + QLatin1String(", ");
+            }
+            queryString += QLatin1String("tracks.rowid");
+
+            QSqlQuery query(db);
+            query.setForwardOnly(true);
+            query.prepare(queryString);
+            for (int i = chunkStart; i < chunkEnd; ++i) {
+                query.addBindValue(i);
+                for (const QString& value : selection.at(i)) {
+                    query.addBindValue(value);
+                }
+            }
+            if (!query.exec()) {
+                qWarning() << "failed to get tracks from database" << query.lastError();
+                break;
+            }
+
+            // Rows of the same matched row are consecutive
+            long long matchedRow = -1;
+            while (query.next()) {
+                const long long row = query.value(0).toLongLong();
+                if (row != matchedRow) {
+                    matchedRow = row;
+                    tracks.append({query.value(1).toInt(),
+                                   query.value(2).toString(),
+                                   query.value(3).toLongLong(),
+                                   query.value(4).toString(),
+                                   QStringList(),
+                                   QStringList(),
+                                   query.value(5).toInt(),
+                                   query.value(6).toString()});
+                }
+                LibraryTrack& track = tracks.last();
+                const QString artist(query.value(7).toString());
+                if (!artist.isEmpty() && !track.artists.contains(artist)) {
+                    track.artists.append(artist);
+                }
+                const QString album(query.value(8).toString());
+                if (!album.isEmpty() && !track.albums.contains(album)) {
+                    track.albums.append(album);
+                }
+            }
+        }
+        return tracks;
+    }
+
+    QStringList DatabaseModel::filePaths(const QVector<LibraryTrack>& tracks)
+    {
+        QStringList filePaths;
+        filePaths.reserve(tracks.size());
+        for (const LibraryTrack& track : tracks) {
+            filePaths.append(track.filePath);
+        }
+        return filePaths;
+    }
+
+    void DatabaseModel::appendRow(const QSqlQuery& query, const QVector<FieldType>& fieldTypes, QHash<QString, int>& stringIndexes, Rows& rows)
+    {
+        for (int field = 0, fieldsCount = fieldTypes.size(); field < fieldsCount; ++field) {
+            switch (fieldTypes.at(field)) {
+            case FieldType::String:
+            {
+                const QString string(query.value(field).toString());
+                auto found(stringIndexes.constFind(string));
+                if (found == stringIndexes.constEnd()) {
+                    found = stringIndexes.insert(string, stringIndexes.size());
+                    rows.strings.append(string);
+                }
+                rows.columns[field].append(found.value());
+                break;
+            }
+            case FieldType::Int:
+                rows.columns[field].append(query.value(field).toInt());
+            }
+        }
+    }
+
+    void DatabaseModel::appendRows(Rows& rows, const Rows& batch)
+    {
+        rows.strings += batch.strings;
+        for (int field = 0, fieldsCount = rows.columns.size(); field < fieldsCount; ++field) {
+            rows.columns[field] += batch.columns.at(field);
+        }
+    }
+
+    QVariant DatabaseModel::fieldValue(const Rows& rows, const QVector<FieldType>& fieldTypes, int row, int field)
+    {
+        const int value = rows.columns.at(field).at(row);
+        if (fieldTypes.at(field) == FieldType::String) {
+            return rows.strings.at(value);
+        }
+        return value;
+    }
+
+    QString DatabaseModel::rowKey(const Rows& rows, int row) const
+    {
+        QString key;
+        for (int field : mKeyFields) {
+            key += rows.strings.at(rows.columns.at(field).at(row));
+            key += QChar(0x1f);
+        }
+        return key;
+    }
+
+    void DatabaseModel::cancelQuery()
+    {
+        if (mQueryState) {
+            QMutexLocker locker(&mQueryState->mutex);
+            mQueryState->cancelled = true;
+        }
+        mQueryState.reset();
+    }
+
+    void DatabaseModel::insertReadRows()
+    {
+        if (!mQueryState) {
+            return;
+        }
+
+        Rows rows;
+        bool finished;
+        {
+            QMutexLocker locker(&mQueryState->mutex);
+            rows = std::move(mQueryState->rows);
+            mQueryState->rows = Rows();
+            mQueryState->notified = false;
+            finished = mQueryState->finished;
+        }
+
+        const int count = rows.columns.isEmpty() ? 0 : rows.columns.first().size();
+        if (mDiffing) {
+            if (count > 0) {
+                appendRows(mNewRows, rows);
+            }
+        } else if (count > 0) {
+            beginInsertRows(QModelIndex(), mRowCount, mRowCount + count - 1);
+            appendRows(mRows, rows);
+            mRowCount += count;
+            endInsertRows();
+        }
+
+        if (finished) {
+            mQueryState.reset();
+
+            if (mDiffing) {
+                mDiffing = false;
+                applyDiff(std::move(mNewRows));
+                mNewRows = Rows();
+            }
+
+            for (QVector<int>& column : mRows.columns) {
+                column.squeeze();
+            }
+            mRows.strings.squeeze();
+
+            if (mRowCount > 0) {
+                size_t size = mRows.columns.size() * mRowCount * sizeof(int);
+                for (const QString& string : mRows.strings) {
+                    size += sizeof(QString) + string.capacity() * sizeof(QChar);
+                }
+                qDebug() << metaObject()->className() << "loaded" << mRowCount << "rows," << size / mRowCount << "bytes per row";
+            }
+        }
+    }
+
+    void DatabaseModel::applyDiff(Rows&& newRows)
+    {
+        const int newRowCount = newRows.columns.first().size();
+
+        const auto reset = [&]() {
+            beginResetModel();
+            mRows = std::move(newRows);
+            mRowCount = newRowCount;
+            endResetModel();
+        };
+
+        // Position of each old row in new rows, or -1 if it was removed
+        QHash<QString, int> newPositions;
+        newPositions.reserve(newRowCount);
+        for (int row = 0; row < newRowCount; ++row) {
+            const QString key(rowKey(newRows, row));
+            if (newPositions.contains(key)) {
+                reset();
+                return;
+            }
+            newPositions.insert(key, row);
+        }
+
+        QVector<int> oldToNew(mRowCount);
+        QVector<bool> kept(newRowCount, false);
+        for (int row = 0; row < mRowCount; ++row) {
+            const int newRow = newPositions.value(rowKey(mRows, row), -1);
+            if (newRow != -1) {
+                if (kept.at(newRow)) {
+                    reset();
+                    return;
+                }
+                kept[newRow] = true;
+            }
+            oldToNew[row] = newRow;
+        }
+
+        // Kept rows that are not in the longest increasing subsequence of their new positions are moved
+        QVector<int> positions;
+        for (int newRow : oldToNew) {
+            if (newRow != -1) {
+                positions.append(newRow);
+            }
+        }
+        QVector<bool> placed(longestIncreasingSubsequence(positions));
+        QVector<int> movedRows;
+        for (int i = 0, max = positions.size(); i < max; ++i) {
+            if (!placed.at(i)) {
+                movedRows.append(positions.at(i));
+            }
+        }
+        if (movedRows.size() > maxMovedRowsCount) {
+            reset();
+            return;
+        }
+        std::sort(movedRows.begin(), movedRows.end());
+
+        // Translate string indexes of new rows to current rows, so that
+        // values can be copied while current rows are still in use
+        QHash<QString, int> stringIndexes;
+        stringIndexes.reserve(mRows.strings.size());
+        for (int i = 0, max = mRows.strings.size(); i < max; ++i) {
+            stringIndexes.insert(mRows.strings.at(i), i);
+        }
+        QVector<int> stringMap;
+        stringMap.reserve(newRows.strings.size());
+        for (const QString& string : newRows.strings) {
+            auto found(stringIndexes.constFind(string));
+            if (found == stringIndexes.constEnd()) {
+                found = stringIndexes.insert(string, mRows.strings.size());
+                mRows.strings.append(string);
+            }
+            stringMap.append(found.value());
+        }
+        QVector<QVector<int>> newColumns(newRows.columns);
+        for (int field = 0, fieldsCount = mFieldTypes.size(); field < fieldsCount; ++field) {
+            if (mFieldTypes.at(field) == FieldType::String) {
+                for (int& value : newColumns[field]) {
+                    value = stringMap.at(value);
+                }
+            }
+        }
+
+        // Removed rows, from the end
+        for (int last = mRowCount - 1; last >= 0; --last) {
+            if (oldToNew.at(last) != -1) {
+                continue;
+            }
+            int first = last;
+            while (first > 0 && oldToNew.at(first - 1) == -1) {
+                --first;
+            }
+            beginRemoveRows(QModelIndex(), first, last);
+            for (QVector<int>& column : mRows.columns) {
+                column.remove(first, last - first + 1);
+            }
+            mRowCount -= (last - first + 1);
+            endRemoveRows();
+            last = first;
+        }
+
+        // Moved rows, in order of new positions. Each one is moved
+        // right after the last already placed row that precedes it
+        for (int newRow : movedRows) {
+            const int from = positions.indexOf(newRow);
+            int after = -1;
+            for (int i = 0, max = positions.size(); i < max; ++i) {
+                if (placed.at(i) && positions.at(i) < newRow) {
+                    after = i;
+                }
+            }
+            const int to = (after < from) ? after + 1 : after;
+            if (to != from) {
+                beginMoveRows(QModelIndex(), from, from, QModelIndex(), after + 1);
+                for (QVector<int>& column : mRows.columns) {
+                    const int value = column.at(from);
+                    column.remove(from);
+                    column.insert(to, value);
+                }
+                positions.remove(from);
+                positions.insert(to, newRow);
+                placed.remove(from);
+                placed.insert(to, false);
+                endMoveRows();
+            }
+            placed[to] = true;
+        }
+
+        // Inserted rows. Rows before each range are already in their new positions
+        for (int first = 0; first < newRowCount; ++first) {
+            if (kept.at(first)) {
+                continue;
+            }
+            int last = first;
+            while (last + 1 < newRowCount && !kept.at(last + 1)) {
+                ++last;
+            }
+            const int count = last - first + 1;
+            beginInsertRows(QModelIndex(), first, last);
+            for (int field = 0, fieldsCount = mFieldTypes.size(); field < fieldsCount; ++field) {
+                QVector<int>& column = mRows.columns[field];
+                column.insert(first, count, 0);
+                std::copy(newColumns.at(field).constBegin() + first,
+                          newColumns.at(field).constBegin() + last + 1,
+                          column.begin() + first);
+            }
+            mRowCount += count;
+            endInsertRows();
+            first = last;
+        }
+
+        // Changed values of kept rows
+        const auto rowChanged = [&](int row) {
+            for (int field = 0, fieldsCount = mFieldTypes.size(); field < fieldsCount; ++field) {
+                if (mRows.columns.at(field).at(row) != newColumns.at(field).at(row)) {
+                    return true;
+                }
+            }
+            return false;
+        };
+        for (int first = 0; first < newRowCount; ++first) {
+            if (!rowChanged(first)) {
+                continue;
+            }
+            int last = first;
+            while (last + 1 < newRowCount && rowChanged(last + 1)) {
+                ++last;
+            }
+            for (int field = 0, fieldsCount = mFieldTypes.size(); field < fieldsCount; ++field) {
+                std::copy(newColumns.at(field).constBegin() + first,
+                          newColumns.at(field).constBegin() + last + 1,
+                          mRows.columns[field].begin() + first);
+            }
+            emit dataChanged(index(first), index(last));
+            first = last;
+        }
+
+        // Same rows, with compact strings
+        mRows = std::move(newRows);
+    }
+
+    const DatabaseModel::Rows& DatabaseModel::rowsForRow(int row, int& rowInRows) const
+    {
+        if (!mPaged) {
+            rowInRows = row;
+            return mRows;
+        }
+
+        const int page = row / pageSize;
+        rowInRows = row % pageSize;
+        const auto found(mPages.constFind(page));
+        if (found == mPages.constEnd()) {
+            requestPage(page);
+            return mEmptyPage;
+        }
+        return found.value();
+    }
+
+    DatabaseModel::Page DatabaseModel::readPage(const PagedQuery& query,
+                                                const QVector<FieldType>& fieldTypes,
+                                                int page,
+                                                int pageRowCount,
+                                                const QVariantList& previousEndKeys)
+    {
+        const QStringList& sortKeys = query.sortKeys;
+        const QLatin1String order(query.descending ? "DESC" : "ASC");
+
+        QVariantList bindValues(query.bindValues);
+
+        QStringList conditions;
+        if (!query.where.isEmpty()) {
+            conditions.append(query.where);
+        }
+
+        // Rows after the last row of previous page: k1 >= ? AND ((k1 > ?) OR (k1 = ? AND k2 > ?) OR ...).
+        // First condition gives index a start of range, so that page is sought instead of scanned for
+        const bool keyset = !previousEndKeys.isEmpty();
+        if (keyset) {
+            // Keys are parenthesized since they can be expressions like "artist = ''"
+            conditions.append(QLatin1Char('(') + sortKeys.first() + (query.descending ? QLatin1String(") <= ?") : QLatin1String(") >= ?")));
+            bindValues.append(previousEndKeys.first());
+
+            const QLatin1String comparison(query.descending ? " < ?" : " > ?");
+            QStringList alternatives;
+            for (int i = 0, max = sortKeys.size(); i < max; ++i) {
+                QString alternative;
+                for (int j = 0; j < i; ++j) {
+                    alternative += QLatin1Char('(') + sortKeys.at(j) + QLatin1String(") = ? AND ");
+                    bindValues.append(previousEndKeys.at(j));
+                }
+                alternative += QLatin1Char('(') + sortKeys.at(i) + QLatin1Char(')') + comparison;
+                bindValues.append(previousEndKeys.at(i));
+                alternatives.append(QLatin1Char('(') + alternative + QLatin1Char(')'));
+            }
+            conditions.append(QLatin1Char('(') + alternatives.join(QLatin1String(" OR ")) + QLatin1Char(')'));
+        }
+
+        QString queryString(QString::fromLatin1("SELECT %1, %2 FROM %3 ").arg(query.fields,
+                                                                             sortKeys.join(QLatin1String(", ")),
+                                                                             query.table));
+        if (!conditions.isEmpty()) {
+            queryString += QLatin1String("WHERE ") + conditions.join(QLatin1String(" AND ")) + QLatin1Char(' ');
+        }
+        if (!query.groupBy.isEmpty()) {
+            queryString += QLatin1String("GROUP BY ") + query.groupBy + QLatin1Char(' ');
+        }
+        QStringList orderBy;
+        for (const QString& key : sortKeys) {
+            orderBy.append(key + QLatin1Char(' ') + order);
+        }
+        queryString += QLatin1String("ORDER BY ") + orderBy.join(QLatin1String(", "));
+        queryString += QLatin1String(" LIMIT ?");
+        bindValues.append(pageSize);
+        if (!keyset && page > 0) {
+            // Jumped over pages whose end is unknown
+            queryString += QLatin1String(" OFFSET ?");
+            bindValues.append(page * pageSize);
+        }
+
+        Page loaded;
+        loaded.rows.strings = {QString()};
+        loaded.rows.columns.resize(fieldTypes.size());
+        QHash<QString, int> stringIndexes{{QString(), 0}};
+
+        const QSqlDatabase db(LibraryUtils::readOnlyDatabase());
+        if (db.isOpen()) {
+            QSqlQuery sqlQuery(db);
+            sqlQuery.setForwardOnly(true);
+            sqlQuery.prepare(queryString);
+            for (const QVariant& value : bindValues) {
+                sqlQuery.addBindValue(value);
+            }
+            if (sqlQuery.exec()) {
+                int count = 0;
+                while (count < pageRowCount && sqlQuery.next()) {
+                    appendRow(sqlQuery, fieldTypes, stringIndexes, loaded.rows);
+                    ++count;
+                    if (count == pageRowCount) {
+                        loaded.endKeys.reserve(sortKeys.size());
+                        for (int i = fieldTypes.size(), max = i + sortKeys.size(); i < max; ++i) {
+                            loaded.endKeys.append(sqlQuery.value(i));
+                        }
+                    }
+                }
+            } else {
+                qWarning() << "failed to load page" << sqlQuery.lastError();
+            }
+        }
+
+        // Database has changed under us, fill the rest with empty values
+        for (QVector<int>& column : loaded.rows.columns) {
+            column.resize(pageRowCount);
+        }
+
+        return loaded;
+    }
+
+    void DatabaseModel::requestPage(int page) const
+    {
+        // Page would be read with row count of the previous query,
+        // rows that are accessed before query is finished are updated after it
+        if (mRefreshingPages || mLoadingPages.contains(page)) {
+            return;
+        }
+        mLoadingPages.insert(page);
+
+        const PagedQuery query(mPagedQuery);
+        const QVector<FieldType> fieldTypes(mFieldTypes);
+        const int pageRowCount = std::min(pageSize, mRowCount - page * pageSize);
+        const QVariantList previousEndKeys(mPageEndKeys.value(page - 1));
+        const int generation = mPagedQueryGeneration;
+
+        auto future = QtConcurrent::run([=]() {
+            return readPage(query, fieldTypes, page, pageRowCount, previousEndKeys);
+        });
+
+        // Pages are a cache, loading one doesn't change model
+        const auto model = const_cast<DatabaseModel*>(this);
+        using FutureWatcher = QFutureWatcher<Page>;
+        auto watcher = new FutureWatcher(model);
+        QObject::connect(watcher, &FutureWatcher::finished, model, [=]() {
+            watcher->deleteLater();
+            if (generation == mPagedQueryGeneration) {
+                model->insertPage(page, watcher->result());
+            }
+        });
+        watcher->setFuture(future);
+    }
+
+    void DatabaseModel::insertPage(int page, const Page& loaded)
+    {
+        mLoadingPages.remove(page);
+        if (!loaded.endKeys.isEmpty()) {
+            mPageEndKeys.insert(page, loaded.endKeys);
+        }
+
+        // Evict pages that are farthest from the loaded one
+        while (mPages.size() >= maxPagesCount) {
+            auto farthest(mPages.begin());
+            for (auto i = mPages.begin(), end = mPages.end(); i != end; ++i) {
+                if (std::abs(i.key() - page) > std::abs(farthest.key() - page)) {
+                    farthest = i;
+                }
+            }
+            mPages.erase(farthest);
+        }
+
+        mPages.insert(page, loaded.rows);
+
+        const int pageRowCount = loaded.rows.columns.isEmpty() ? 0 : loaded.rows.columns.first().size();
+        if (pageRowCount > 0) {
+            emit dataChanged(index(page * pageSize), index(page * pageSize + pageRowCount - 1));
+        }
+    }
+
+    void DatabaseModel::applyPagedQueryResult(const PagedQueryResult& result)
+    {
+        mRefreshingPages = false;
+
+        const int oldRowCount = mRowCount;
+        const int newRowCount = result.count;
+
+        if (newRowCount < oldRowCount) {
+            beginRemoveRows(QModelIndex(), newRowCount, oldRowCount - 1);
+            mRowCount = newRowCount;
+            endRemoveRows();
+        }
+
+        // Rows of reloaded pages that are different now, as [first, last] ranges
+        QVector<QPair<int, int>> changedRanges;
+        const auto addChanged = [&](int first, int last) {
+            if (!changedRanges.isEmpty() && changedRanges.last().second + 1 == first) {
+                changedRanges.last().second = last;
+            } else {
+                changedRanges.append({first, last});
+            }
+        };
+
+        const int comparedRowCount = std::min(oldRowCount, newRowCount);
+        QHash<int, Rows> pages;
+        for (auto i = result.pages.cbegin(), end = result.pages.cend(); i != end; ++i) {
+            const int page = i.key();
+            const Rows& oldRows = mPages.value(page, mEmptyPage);
+            const Rows& newRows = i.value().rows;
+            for (int row = page * pageSize, max = std::min(row + pageSize, comparedRowCount); row < max; ++row) {
+                for (int field = 0, fieldsCount = mFieldTypes.size(); field < fieldsCount; ++field) {
+                    if (fieldValue(oldRows, mFieldTypes, row % pageSize, field) != fieldValue(newRows, mFieldTypes, row % pageSize, field)) {
+                        addChanged(row, row);
+                        break;
+                    }
+                }
+            }
+            pages.insert(page, newRows);
+            if (!i.value().endKeys.isEmpty()) {
+                mPageEndKeys.insert(page, i.value().endKeys);
+            }
+        }
+        mPages = pages;
+
+        // Views may still show rows of pages that are not loaded, they are requested again
+        for (int page = 0, pagesCount = (comparedRowCount + pageSize - 1) / pageSize; page < pagesCount; ++page) {
+            if (!mPages.contains(page)) {
+                addChanged(page * pageSize, std::min((page + 1) * pageSize, comparedRowCount) - 1);
+            }
+        }
+        std::sort(changedRanges.begin(), changedRanges.end());
+
+        if (newRowCount > oldRowCount) {
+            beginInsertRows(QModelIndex(), oldRowCount, newRowCount - 1);
+            mRowCount = newRowCount;
+            endInsertRows();
+        }
+
+        for (const QPair<int, int>& range : changedRanges) {
+            emit dataChanged(index(range.first), index(range.second));
         }
     }
 }
@@ -19,28 +19,150 @@
 #ifndef UNPLAYER_DATABASEMODEL_H
 #define UNPLAYER_DATABASEMODEL_H
 
+#include <functional>
 #include <memory>
 
 #include <QAbstractListModel>
+#include <QHash>
 #include <QQmlParserStatus>
-#include <QSqlQuery>
+#include <QSet>
+#include <QStringList>
+#include <QVariantList>
+#include <QVector>
+
+class QSqlQuery;
 
 namespace unplayer
 {
+    struct LibraryTrack;
+
     class DatabaseModel : public QAbstractListModel, public QQmlParserStatus
     {
         Q_OBJECT
         Q_INTERFACES(QQmlParserStatus)
     public:
-        DatabaseModel();
+        ~DatabaseModel() override;
         void classBegin() override;
         void componentComplete() override;
         int rowCount(const QModelIndex& parent) const override;
     protected:
-        void execQuery();
+        enum class FieldType
+        {
+            String,
+            Int
+        };
+
+        // Key fields are string fields that identify row, they are used to
+        // find rows that were inserted, removed or moved when query is re-executed
+        DatabaseModel(const QVector<FieldType>& fieldTypes, const QVector<int>& keyFields);
+
+        // Called again when database is changed
+        virtual void setQuery() = 0;
+
+        // Query for paged mode. Only row count is queried when model is reset,
+        // rows are loaded by pages when they are accessed. Page is found using
+        // last row of previous page (keyset), and only a few pages are kept.
+        // Count and pages are read in worker threads, rows of page that is not
+        // loaded yet have empty values until it is. When query is executed again,
+        // loaded pages are read again and model is updated without reset
+        struct PagedQuery
+        {
+            // Selected fields, in the same order as field types
+            QString fields;
+            QString table;
+            // Optional, without WHERE and GROUP BY keywords
+            QString where;
+            QString groupBy;
+            // Sort keys are sorted in the same direction, they can't be NULL
+            // and together they must identify row uniquely
+            QStringList sortKeys;
+            bool descending = false;
+            QVariantList bindValues;
+        };
+
+        // Executes query in a worker thread, query that is still running is cancelled.
+        // If model has all rows of previous query, they are updated in place when
+        // new query is finished. Otherwise model is reset and rows are inserted as they are read
+        void execQuery(const QString& query, const QVariantList& bindValues = QVariantList());
+        void execPagedQuery(const PagedQuery& query);
+
+        const QString& stringValue(int row, int field) const;
+        int intValue(int row, int field) const;
+
+        // Values of fields of given rows. Loaded rows are copied now, returned function
+        // reads pages that are not loaded, it can be called from any thread
+        std::function<QVector<QVariantList>()> rowsValues(const QVector<int>& rows, const QVector<int>& fields) const;
+
+        // Tracks whose key columns are equal to values of any selection row,
+        // ordered by selection row first, then by orderBy if it is not empty. Rows are matched by a few queries
+        // instead of one per row. Can be called from any thread
+        static QVector<LibraryTrack> getLibraryTracks(const QStringList& keyColumns,
+                                                      const QVector<QStringList>& selection,
+                                                      const QString& where,
+                                                      const QString& orderBy);
+        static QStringList filePaths(const QVector<LibraryTrack>& tracks);
 
-        std::unique_ptr<QSqlQuery> mQuery;
         int mRowCount;
+
+    private:
+        // Query results stored column by column. String columns contain
+        // indexes in strings vector, where each distinct string is stored once
+        struct Rows
+        {
+            QVector<QString> strings;
+            QVector<QVector<int>> columns;
+        };
+
+        struct QueryState;
+        struct Page;
+        struct PagedQueryResult;
+
+        static void appendRow(const QSqlQuery& query, const QVector<FieldType>& fieldTypes, QHash<QString, int>& stringIndexes, Rows& rows);
+        static void appendRows(Rows& rows, const Rows& batch);
+        static QVariant fieldValue(const Rows& rows, const QVector<FieldType>& fieldTypes, int row, int field);
+        QString rowKey(const Rows& rows, int row) const;
+
+        void cancelQuery();
+        void insertReadRows();
+        void applyDiff(Rows&& newRows);
+
+        const Rows& rowsForRow(int row, int& rowInRows) const;
+        // Can be called from any thread
+        static Page readPage(const PagedQuery& query,
+                             const QVector<FieldType>& fieldTypes,
+                             int page,
+                             int pageRowCount,
+                             const QVariantList& previousEndKeys);
+        void requestPage(int page) const;
+        void insertPage(int page, const Page& loaded);
+        // Diffs new row count and reloaded pages with current ones instead of resetting model
+        void applyPagedQueryResult(const PagedQueryResult& result);
+
+        const QVector<FieldType> mFieldTypes;
+        const QVector<int> mKeyFields;
+        Rows mRows;
+        std::shared_ptr<QueryState> mQueryState;
+        bool mQueryExecuted;
+
+        // Rows of query that will be diffed with current rows
+        bool mDiffing;
+        Rows mNewRows;
+
+        bool mPaged;
+        PagedQuery mPagedQuery;
+        mutable QHash<int, Rows> mPages;
+        // Sort keys of the last row of page, kept when page is evicted
+        mutable QHash<int, QVariantList> mPageEndKeys;
+        mutable QSet<int> mLoadingPages;
+        // Results of count and pages of previous queries are dropped
+        int mPagedQueryGeneration;
+        // Values of rows of page that is not loaded
+        Rows mEmptyPage;
+        // Paged query is re-executed, count and loaded pages are being read again
+        bool mRefreshingPages;
+
+    signals:
+        void rowsRead(QPrivateSignal);
     };
 }
 
@@ -0,0 +1,120 @@
+/*
+ * Unplayer
+ * Copyright (C) 2015-2017 Alexey Rochev <equeim@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "embeddedmediaartprovider.h"
+
+#include <QDebug>
+#include <QMimeDatabase>
+#include <QStringList>
+#include <QUrl>
+
+#include "tagutils.h"
+
+namespace unplayer
+{
+    namespace
+    {
+        struct Location
+        {
+            QString filePath;
+            long long offset;
+            long long length;
+            QString mimeType;
+        };
+
+        // Id format is "<offset>:<length>:<MIME type>:<percent-encoded file path>",
+        // file path is encoded so that QUrl does not change it
+        bool parseId(const QString& id, Location& location)
+        {
+            const QStringList parts(id.split(QLatin1Char(':')));
+            if (parts.size() != 4) {
+                return false;
+            }
+
+            bool ok = false;
+            location.offset = parts.at(0).toLongLong(&ok);
+            if (!ok) {
+                return false;
+            }
+            location.length = parts.at(1).toLongLong(&ok);
+            if (!ok) {
+                return false;
+            }
+            location.mimeType = parts.at(2);
+            location.filePath = QUrl::fromPercentEncoding(parts.at(3).toUtf8());
+
+            return !location.filePath.isEmpty();
+        }
+    }
+
+    const QString EmbeddedMediaArtProvider::providerId(QLatin1String("embedded"));
+
+    QString EmbeddedMediaArtProvider::url(const QString& filePath, const tagutils::Info& info)
+    {
+        return QString::fromLatin1("image://%1/%2:%3:%4:%5").arg(providerId,
+                                                                  QString::number(info.mediaArtOffset),
+                                                                  QString::number(info.mediaArtLength),
+                                                                  info.mediaArtMimeType,
+                                                                  QString::fromLatin1(QUrl::toPercentEncoding(filePath)));
+    }
+
+    bool EmbeddedMediaArtProvider::isEmbeddedMediaArtUrl(const QString& mediaArt)
+    {
+        return mediaArt.startsWith(QString::fromLatin1("image://%1/").arg(providerId));
+    }
+
+    EmbeddedMediaArtProvider::EmbeddedMediaArtProvider()
+        : QQuickImageProvider(QQuickImageProvider::Image)
+    {
+
+    }
+
+    QImage EmbeddedMediaArtProvider::requestImage(const QString& id, QSize* size, const QSize& requestedSize)
+    {
+        Location location;
+        if (!parseId(id, location)) {
+            qWarning() << "invalid embedded media art id:" << id;
+            return QImage();
+        }
+
+        // Image format is known, so that QImage does not have to detect it
+        const QByteArray format(QMimeDatabase().mimeTypeForName(location.mimeType).preferredSuffix().toLatin1());
+        QImage image;
+        if (!image.loadFromData(tagutils::getMediaArtData(location.filePath, location.offset, location.length),
+                                format.isEmpty() ? nullptr : format.constData())) {
+            qWarning() << "failed to load embedded media art from file:" << location.filePath;
+            return QImage();
+        }
+
+        if (size) {
+            *size = image.size();
+        }
+
+        if (requestedSize.isValid()) {
+            QSize newSize(requestedSize);
+            if (newSize.width() == 0) {
+                newSize.setWidth(image.width());
+            }
+            if (newSize.height() == 0) {
+                newSize.setHeight(image.height());
+            }
+            return image.scaled(newSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        }
+
+        return image;
+    }
+}
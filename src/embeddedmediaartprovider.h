@@ -0,0 +1,43 @@
+/*
+ * Unplayer
+ * Copyright (C) 2015-2017 Alexey Rochev <equeim@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef UNPLAYER_EMBEDDEDMEDIAARTPROVIDER_H
+#define UNPLAYER_EMBEDDEDMEDIAARTPROVIDER_H
+
+#include <QQuickImageProvider>
+
+namespace unplayer
+{
+    namespace tagutils
+    {
+        struct Info;
+    }
+
+    // Loads media art embedded in audio files, directly from its location in the file
+    class EmbeddedMediaArtProvider : public QQuickImageProvider
+    {
+    public:
+        static const QString providerId;
+        static QString url(const QString& filePath, const tagutils::Info& info);
+        static bool isEmbeddedMediaArtUrl(const QString& mediaArt);
+
+        EmbeddedMediaArtProvider();
+        QImage requestImage(const QString& id, QSize* size, const QSize& requestedSize) override;
+    };
+}
+
+#endif // UNPLAYER_EMBEDDEDMEDIAARTPROVIDER_H
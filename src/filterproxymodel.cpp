@@ -23,8 +23,24 @@
 
 namespace unplayer
 {
+    namespace
+    {
+        // Case-folded and without diacritics, so that "bjo" matches "Björk"
+        QString foldedSearchKey(const QString& string)
+        {
+            QString key(string.normalized(QString::NormalizationForm_KD).toCaseFolded());
+            const auto end = std::remove_if(key.begin(), key.end(), [](QChar ch) {
+                return ch.category() == QChar::Mark_NonSpacing;
+            });
+            key.truncate(end - key.begin());
+            return key;
+        }
+    }
+
     FilterProxyModel::FilterProxyModel()
         : mSortEnabled(false),
+          mFilterKeysValid(false),
+          mSortKeysValid(false),
           mSelectionModel(new QItemSelectionModel(this))
     {
         mCollator.setNumericMode(true);
@@ -38,11 +54,37 @@ namespace unplayer
 
     void FilterProxyModel::componentComplete()
     {
+        invalidateSortKeys();
         if (mSortEnabled) {
             sort(0);
         }
     }
 
+    void FilterProxyModel::setSourceModel(QAbstractItemModel* sourceModel)
+    {
+        for (const QMetaObject::Connection& connection : mSourceConnections) {
+            QObject::disconnect(connection);
+        }
+        mSourceConnections.clear();
+        invalidateKeys();
+
+        // Connect before QSortFilterProxyModel does, so that filter and sort keys
+        // are up to date when it calls filterAcceptsRow() and lessThan()
+        if (sourceModel) {
+            mSourceConnections.append(QObject::connect(sourceModel, &QAbstractItemModel::rowsInserted, this, &FilterProxyModel::onSourceRowsInserted));
+            mSourceConnections.append(QObject::connect(sourceModel, &QAbstractItemModel::rowsRemoved, this, &FilterProxyModel::onSourceRowsRemoved));
+            mSourceConnections.append(QObject::connect(sourceModel, &QAbstractItemModel::dataChanged, this, &FilterProxyModel::onSourceDataChanged));
+            mSourceConnections.append(QObject::connect(sourceModel, &QAbstractItemModel::rowsMoved, this, &FilterProxyModel::rebuildKeys));
+            mSourceConnections.append(QObject::connect(sourceModel, &QAbstractItemModel::layoutChanged, this, &FilterProxyModel::rebuildKeys));
+            mSourceConnections.append(QObject::connect(sourceModel, &QAbstractItemModel::modelReset, this, &FilterProxyModel::rebuildKeys));
+        }
+
+        QSortFilterProxyModel::setSourceModel(sourceModel);
+
+        // Rows are filtered from the start if filter text is already set
+        rebuildKeys();
+    }
+
     QVector<int> FilterProxyModel::sourceIndexes() const
     {
         QVector<int> indexes;
@@ -63,6 +105,44 @@ namespace unplayer
         mSortEnabled = sortEnabled;
     }
 
+    const QString& FilterProxyModel::filterText() const
+    {
+        return mFilterText;
+    }
+
+    void FilterProxyModel::setFilterText(const QString& text)
+    {
+        const QString pattern(foldedSearchKey(text));
+        mFilterText = text;
+        if (pattern == mFilterMatcher.pattern()) {
+            return;
+        }
+
+        // Extended query can only match rows that matched the previous one
+        const bool narrowing = mFilterKeysValid &&
+                               !mFilterMatcher.pattern().isEmpty() &&
+                               pattern.contains(mFilterMatcher.pattern());
+        mFilterMatcher.setPattern(pattern);
+
+        if (!pattern.isEmpty()) {
+            if (!mFilterKeysValid) {
+                buildFilterKeys();
+            } else if (narrowing) {
+                for (int i = 0, max = mFilterKeys.size(); i < max; ++i) {
+                    if (mFilterAccepted[i]) {
+                        mFilterAccepted[i] = filterKeyMatches(mFilterKeys[i]);
+                    }
+                }
+            } else {
+                for (int i = 0, max = mFilterKeys.size(); i < max; ++i) {
+                    mFilterAccepted[i] = filterKeyMatches(mFilterKeys[i]);
+                }
+            }
+        }
+
+        invalidateFilter();
+    }
+
     int FilterProxyModel::proxyIndex(int sourceIndex) const
     {
         return mapFromSource(sourceModel()->index(sourceIndex, 0)).row();
@@ -116,12 +196,186 @@ namespace unplayer
         mSelectionModel->select(QItemSelection(index(0, 0), index(rowCount() - 1, 0)), QItemSelectionModel::Select);
     }
 
+    bool FilterProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const
+    {
+        if (mFilterMatcher.pattern().isEmpty()) {
+            return QSortFilterProxyModel::filterAcceptsRow(sourceRow, sourceParent);
+        }
+        if (mFilterKeysValid && sourceRow < mFilterAccepted.size()) {
+            return mFilterAccepted[sourceRow];
+        }
+        return filterKeyMatches(filterKey(sourceRow));
+    }
+
     bool FilterProxyModel::lessThan(const QModelIndex& left, const QModelIndex& right) const
     {
+        if (buildSortKeys()) {
+            return (mSortKeys[left.row()].compare(mSortKeys[right.row()]) < 0);
+        }
         const QVariant leftVariant(left.data(sortRole()));
         if (leftVariant.type() == QVariant::String) {
             return (mCollator.compare(leftVariant.toString(), right.data(sortRole()).toString()) < 0);
         }
         return QSortFilterProxyModel::lessThan(left, right);
     }
+
+    QString FilterProxyModel::filterKey(int sourceRow) const
+    {
+        return foldedSearchKey(sourceModel()->index(sourceRow, filterKeyColumn()).data(filterRole()).toString());
+    }
+
+    bool FilterProxyModel::filterKeyMatches(const QString& key) const
+    {
+        return mFilterMatcher.indexIn(key) != -1;
+    }
+
+    void FilterProxyModel::buildFilterKeys()
+    {
+        const int count = sourceModel() ? sourceModel()->rowCount() : 0;
+        mFilterKeys.clear();
+        mFilterKeys.reserve(count);
+        mFilterAccepted.clear();
+        mFilterAccepted.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            mFilterKeys.append(filterKey(i));
+            mFilterAccepted.append(filterKeyMatches(mFilterKeys.last()));
+        }
+        mFilterKeysValid = true;
+    }
+
+    void FilterProxyModel::invalidateFilterKeys()
+    {
+        mFilterKeysValid = false;
+        mFilterKeys.clear();
+        mFilterAccepted.clear();
+    }
+
+    bool FilterProxyModel::buildSortKeys() const
+    {
+        if (mSortKeysValid) {
+            return !mSortKeys.empty();
+        }
+
+        mSortKeysValid = true;
+        mSortKeys.clear();
+
+        const int count = sourceModel() ? sourceModel()->rowCount() : 0;
+        mSortKeys.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            const QVariant variant(sourceModel()->index(i, sortColumn()).data(sortRole()));
+            if (variant.type() != QVariant::String) {
+                mSortKeys.clear();
+                return false;
+            }
+            mSortKeys.push_back(mCollator.sortKey(variant.toString()));
+        }
+        return !mSortKeys.empty();
+    }
+
+    void FilterProxyModel::invalidateSortKeys()
+    {
+        mSortKeysValid = false;
+        mSortKeys.clear();
+    }
+
+    void FilterProxyModel::invalidateKeys()
+    {
+        invalidateFilterKeys();
+        invalidateSortKeys();
+    }
+
+    void FilterProxyModel::rebuildKeys()
+    {
+        // Sort keys are built when rows are sorted
+        invalidateKeys();
+        if (!mFilterMatcher.pattern().isEmpty()) {
+            buildFilterKeys();
+        }
+    }
+
+    void FilterProxyModel::onSourceRowsInserted(const QModelIndex& parent, int first, int last)
+    {
+        if (parent.isValid()) {
+            return;
+        }
+
+        if (!mSortKeys.empty()) {
+            for (int i = first; i <= last; ++i) {
+                const QVariant variant(sourceModel()->index(i, sortColumn()).data(sortRole()));
+                if (variant.type() != QVariant::String) {
+                    invalidateSortKeys();
+                    break;
+                }
+                mSortKeys.insert(mSortKeys.begin() + i, mCollator.sortKey(variant.toString()));
+            }
+        } else {
+            invalidateSortKeys();
+        }
+
+        if (!mFilterKeysValid) {
+            if (!mFilterMatcher.pattern().isEmpty()) {
+                buildFilterKeys();
+            }
+            return;
+        }
+        const int count = last - first + 1;
+        mFilterKeys.insert(first, count, QString());
+        mFilterAccepted.insert(first, count, false);
+        for (int i = first; i <= last; ++i) {
+            mFilterKeys[i] = filterKey(i);
+            mFilterAccepted[i] = filterKeyMatches(mFilterKeys[i]);
+        }
+    }
+
+    void FilterProxyModel::onSourceRowsRemoved(const QModelIndex& parent, int first, int last)
+    {
+        if (parent.isValid()) {
+            return;
+        }
+
+        if (!mSortKeys.empty()) {
+            mSortKeys.erase(mSortKeys.begin() + first, mSortKeys.begin() + last + 1);
+        }
+        if (mSortKeys.empty()) {
+            invalidateSortKeys();
+        }
+
+        if (!mFilterKeysValid) {
+            if (!mFilterMatcher.pattern().isEmpty()) {
+                buildFilterKeys();
+            }
+            return;
+        }
+        const int count = last - first + 1;
+        mFilterKeys.remove(first, count);
+        mFilterAccepted.remove(first, count);
+    }
+
+    void FilterProxyModel::onSourceDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight, const QVector<int>& roles)
+    {
+        if (!mSortKeys.empty() && (roles.isEmpty() || roles.contains(sortRole()))) {
+            for (int i = topLeft.row(), max = bottomRight.row(); i <= max; ++i) {
+                const QVariant variant(sourceModel()->index(i, sortColumn()).data(sortRole()));
+                if (variant.type() != QVariant::String) {
+                    invalidateSortKeys();
+                    break;
+                }
+                mSortKeys[i] = mCollator.sortKey(variant.toString());
+            }
+        }
+
+        if (!roles.isEmpty() && !roles.contains(filterRole())) {
+            return;
+        }
+        if (!mFilterKeysValid) {
+            if (!mFilterMatcher.pattern().isEmpty()) {
+                buildFilterKeys();
+            }
+            return;
+        }
+        for (int i = topLeft.row(), max = bottomRight.row(); i <= max; ++i) {
+            mFilterKeys[i] = filterKey(i);
+            mFilterAccepted[i] = filterKeyMatches(mFilterKeys[i]);
+        }
+    }
 }
@@ -22,6 +22,10 @@
 #include <QCollator>
 #include <QQmlParserStatus>
 #include <QSortFilterProxyModel>
+#include <QStringMatcher>
+#include <QVector>
+
+#include <vector>
 
 class QItemSelectionModel;
 
@@ -32,6 +36,7 @@ namespace unplayer
         Q_OBJECT
         Q_INTERFACES(QQmlParserStatus)
         Q_PROPERTY(bool sortEnabled READ isSortEnabled WRITE setSortEnabled)
+        Q_PROPERTY(QString filterText READ filterText WRITE setFilterText)
         Q_PROPERTY(QVector<int> sourceIndexes READ sourceIndexes)
         Q_PROPERTY(QItemSelectionModel* selectionModel READ selectionModel CONSTANT)
         Q_PROPERTY(bool hasSelection READ hasSelection NOTIFY selectionChanged)
@@ -42,11 +47,16 @@ namespace unplayer
         void classBegin() override;
         void componentComplete() override;
 
+        void setSourceModel(QAbstractItemModel* sourceModel) override;
+
         QVector<int> sourceIndexes() const;
 
         bool isSortEnabled() const;
         void setSortEnabled(bool sortEnabled);
 
+        const QString& filterText() const;
+        void setFilterText(const QString& text);
+
         Q_INVOKABLE int proxyIndex(int sourceIndex) const;
         Q_INVOKABLE int sourceIndex(int proxyIndex) const;
 
@@ -59,11 +69,42 @@ namespace unplayer
         Q_INVOKABLE void selectAll();
 
     protected:
+        bool filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const override;
         bool lessThan(const QModelIndex& left, const QModelIndex& right) const override;
 
     private:
+        QString filterKey(int sourceRow) const;
+        bool filterKeyMatches(const QString& key) const;
+        void buildFilterKeys();
+        void invalidateFilterKeys();
+
+        bool buildSortKeys() const;
+        void invalidateSortKeys();
+        void invalidateKeys();
+        // Called when source rows are reset or reordered
+        void rebuildKeys();
+
+        void onSourceRowsInserted(const QModelIndex& parent, int first, int last);
+        void onSourceRowsRemoved(const QModelIndex& parent, int first, int last);
+        void onSourceDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight, const QVector<int>& roles);
+
         QCollator mCollator;
         bool mSortEnabled;
+
+        QString mFilterText;
+        QStringMatcher mFilterMatcher;
+        // Case-folded filter role values and filter results, by source row
+        bool mFilterKeysValid;
+        QVector<QString> mFilterKeys;
+        QVector<bool> mFilterAccepted;
+
+        // Collation keys of sort role values, by source row.
+        // Empty if sort role is not a string
+        mutable bool mSortKeysValid;
+        mutable std::vector<QCollatorSortKey> mSortKeys;
+
+        QVector<QMetaObject::Connection> mSourceConnections;
+
         QItemSelectionModel* mSelectionModel;
     signals:
         void selectionChanged();
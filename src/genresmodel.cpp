@@ -18,8 +18,9 @@
 
 #include "genresmodel.h"
 
-#include <QDebug>
-
+#include "libraryutils.h"
+#include "player.h"
+#include "queue.h"
 #include "settings.h"
 
 namespace unplayer
@@ -42,21 +43,26 @@ namespace unplayer
     }
 
     GenresModel::GenresModel()
-        : mSortDescending(Settings::instance()->genresSortDescending())
+        : DatabaseModel({FieldType::String,
+                         FieldType::Int,
+                         FieldType::Int},
+                        {GenreField}),
+          mSortDescending(Settings::instance()->genresSortDescending())
     {
         setQuery();
     }
 
     QVariant GenresModel::data(const QModelIndex& index, int role) const
     {
-        mQuery->seek(index.row());
+        const int row = index.row();
+
         switch (role) {
         case GenreRole:
-            return mQuery->value(GenreField);
+            return stringValue(row, GenreField);
         case TracksCountRole:
-            return mQuery->value(TracksCountField);
+            return intValue(row, TracksCountField);
         case DurationRole:
-            return mQuery->value(DurationField);
+            return intValue(row, DurationField);
         default:
             return QVariant();
         }
@@ -77,33 +83,20 @@ namespace unplayer
 
     QStringList GenresModel::getTracksForGenre(int index) const
     {
-        QSqlQuery query;
-        query.prepare(QStringLiteral("SELECT filePath FROM tracks "
-                                     "WHERE genre = ?  "
-                                     "ORDER BY artist = '', artist, album = '', year, album, trackNumber, title"));
-        mQuery->seek(index);
-        query.addBindValue(mQuery->value(GenreField).toString());
-        if (query.exec()) {
-            QStringList tracks;
-            while (query.next()) {
-                tracks.append(query.value(0).toString());
-            }
-            return tracks;
-        }
-
-        qWarning() << "failed to get tracks from database";
-        return QStringList();
+        return getTracksForGenres({index});
     }
 
     QStringList GenresModel::getTracksForGenres(const QVector<int>& indexes) const
     {
-        QStringList tracks;
-        QSqlDatabase::database().transaction();
-        for (int index : indexes) {
-            tracks.append(getTracksForGenre(index));
-        }
-        QSqlDatabase::database().commit();
-        return tracks;
+        return filePaths(getTracksForSelection(selectedGenres(indexes)));
+    }
+
+    void GenresModel::addTracksForGenresToQueue(const QVector<int>& indexes) const
+    {
+        const QVector<QStringList> selection(selectedGenres(indexes));
+        Player::instance()->queue()->addLibraryTracks([selection]() {
+            return getTracksForSelection(selection);
+        });
     }
 
     QHash<int, QByteArray> GenresModel::roleNames() const
@@ -113,15 +106,30 @@ namespace unplayer
                 {DurationRole, "duration"}};
     }
 
+    QVector<QStringList> GenresModel::selectedGenres(const QVector<int>& indexes) const
+    {
+        QVector<QStringList> selection;
+        selection.reserve(indexes.size());
+        for (int index : indexes) {
+            selection.append({stringValue(index, GenreField)});
+        }
+        return selection;
+    }
+
+    QVector<LibraryTrack> GenresModel::getTracksForSelection(const QVector<QStringList>& selection)
+    {
+        return getLibraryTracks({QLatin1String("genre")},
+                                selection,
+                                QString(),
+                                QLatin1String("artistSortKey, album = '', year, albumSortKey, trackNumber, titleSortKey"));
+    }
+
     void GenresModel::setQuery()
     {
-        beginResetModel();
-        mQuery->prepare(QString::fromLatin1("SELECT genre, COUNT(*), SUM(duration) FROM tracks "
-                                            "WHERE genre != '' "
-                                            "GROUP BY genre "
-                                            "ORDER BY genre %1").arg(mSortDescending ? QLatin1String("DESC")
-                                                                                     : QLatin1String("ASC")));
-        execQuery();
-        endResetModel();
+        execQuery(QString::fromLatin1("SELECT genre, COUNT(*), SUM(duration) FROM tracks "
+                                      "WHERE genre != '' "
+                                      "GROUP BY genre "
+                                      "ORDER BY genre %1").arg(mSortDescending ? QLatin1String("DESC")
+                                                                               : QLatin1String("ASC")));
     }
 }
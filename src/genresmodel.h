@@ -37,11 +37,16 @@ namespace unplayer
 
         Q_INVOKABLE QStringList getTracksForGenre(int index) const;
         Q_INVOKABLE QStringList getTracksForGenres(const QVector<int>& indexes) const;
+        // Tracks are selected in a worker thread
+        Q_INVOKABLE void addTracksForGenresToQueue(const QVector<int>& indexes) const;
     protected:
         QHash<int, QByteArray> roleNames() const override;
 
     private:
-        void setQuery();
+        void setQuery() override;
+
+        QVector<QStringList> selectedGenres(const QVector<int>& indexes) const;
+        static QVector<LibraryTrack> getTracksForSelection(const QVector<QStringList>& selection);
 
         bool mSortDescending;
 
@@ -18,12 +18,14 @@
 
 #include "libraryutils.h"
 
+#include <algorithm>
+#include <clocale>
+#include <cstring>
 #include <functional>
 #include <memory>
 
 
 #include <QCoreApplication>
-#include <QCryptographicHash>
 #include <QDateTime>
 #include <QDebug>
 #include <QDir>
@@ -39,9 +41,11 @@
 #include <QSqlRecord>
 #include <QSqlQuery>
 #include <QStandardPaths>
+#include <QThreadStorage>
 #include <QUuid>
 #include <QtConcurrentRun>
 
+#include "embeddedmediaartprovider.h"
 #include "settings.h"
 #include "tagutils.h"
 
@@ -76,6 +80,129 @@ namespace unplayer
         std::unique_ptr<LibraryUtils> instancePointer;
 
 
+        QString getTrackMediaArt(const tagutils::Info& info,
+                                 const QFileInfo& fileInfo,
+                                 QHash<QString, QString>& directoriesHash,
+                                 bool useDirectoriesMediaArt)
+        {
+            QString mediaArt;
+            if (useDirectoriesMediaArt) {
+                mediaArt = LibraryUtils::findMediaArtForDirectory(directoriesHash, fileInfo.path());
+                if (mediaArt.isEmpty() && info.hasMediaArt) {
+                    mediaArt = EmbeddedMediaArtProvider::url(fileInfo.filePath(), info);
+                }
+            } else {
+                if (info.hasMediaArt) {
+                    mediaArt = EmbeddedMediaArtProvider::url(fileInfo.filePath(), info);
+                } else {
+                    mediaArt = LibraryUtils::findMediaArtForDirectory(directoriesHash, fileInfo.path());
+                }
+            }
+            return mediaArt;
+        }
+
+        tagutils::Info getTrackInfo(const QFileInfo& fileInfo,
+                                    const QString& mimeType,
+                                    QHash<QString, QString>& directoriesHash,
+                                    bool useDirectoriesMediaArt)
+        {
+            // Don't look for embedded media art if it won't be used
+            const bool embeddedMediaArt = !useDirectoriesMediaArt ||
+                                          LibraryUtils::findMediaArtForDirectory(directoriesHash, fileInfo.path()).isEmpty();
+            return tagutils::getTrackInfo(fileInfo, mimeType, embeddedMediaArt);
+        }
+
+        void setConnectionPragmas(const QSqlDatabase& db)
+        {
+            static const QLatin1String pragmas[] = {QLatin1String("PRAGMA synchronous = NORMAL"),
+                                                    QLatin1String("PRAGMA cache_size = -8192"),
+                                                    QLatin1String("PRAGMA mmap_size = 67108864"),
+                                                    QLatin1String("PRAGMA temp_store = MEMORY")};
+            QSqlQuery query(db);
+            for (const QLatin1String& pragma : pragmas) {
+                if (!query.exec(pragma)) {
+                    qWarning() << "failed to execute" << pragma << query.lastError();
+                }
+            }
+        }
+
+        class ReadOnlyConnection
+        {
+        public:
+            explicit ReadOnlyConnection(const QString& databaseFilePath)
+                : name(QString::fromLatin1("unplayer_read_%1").arg(reinterpret_cast<quintptr>(this)))
+            {
+                auto db = QSqlDatabase::addDatabase(QLatin1String("QSQLITE"), name);
+                db.setDatabaseName(databaseFilePath);
+                db.setConnectOptions(QLatin1String("QSQLITE_OPEN_READONLY"));
+                if (db.open()) {
+                    setConnectionPragmas(db);
+                } else {
+                    qWarning() << "failed to open database" << db.lastError();
+                }
+            }
+
+            ~ReadOnlyConnection()
+            {
+                QSqlDatabase::removeDatabase(name);
+            }
+
+            const QString name;
+        };
+
+        // One connection per thread, since QSqlDatabase can't be shared between threads.
+        // Worker threads are reused by the thread pool, and so are their connections
+        QThreadStorage<ReadOnlyConnection*> readOnlyConnections;
+
+        // Locale that LC_COLLATE was set to by QCoreApplication
+        QByteArray collationLocale()
+        {
+            return QByteArray(std::setlocale(LC_COLLATE, nullptr));
+        }
+
+        // SQLite compares BLOBs bytewise, so keys are transformed with strxfrm() to compare
+        // in collation order of the locale. In "C" locale that would only compare code points,
+        // then case-folded key without diacritics is used. Empty strings go last
+        QByteArray sortKey(const QString& string, bool stripArticle)
+        {
+            if (string.isEmpty()) {
+                return QByteArrayLiteral("1");
+            }
+
+            QString key(string);
+            if (stripArticle) {
+                static const QLatin1String article("the ");
+                if (key.size() > article.size() && key.startsWith(article, Qt::CaseInsensitive)) {
+                    key.remove(0, article.size());
+                }
+            }
+
+            static const bool cLocale = [] {
+                const QByteArray locale(collationLocale());
+                return (locale == "C" || locale == "POSIX");
+            }();
+
+            if (cLocale) {
+                key = key.normalized(QString::NormalizationForm_KD).toCaseFolded();
+                const auto end = std::remove_if(key.begin(), key.end(), [](QChar ch) {
+                    return ch.category() == QChar::Mark_NonSpacing;
+                });
+                key.truncate(end - key.begin());
+                return '0' + key.toUtf8();
+            }
+
+            const QByteArray local(key.toLocal8Bit());
+            QByteArray transformed;
+            transformed.resize(local.size() * 4 + 1);
+            size_t size = std::strxfrm(transformed.data(), local.constData(), transformed.size());
+            if (size >= static_cast<size_t>(transformed.size())) {
+                transformed.resize(static_cast<int>(size) + 1);
+                std::strxfrm(transformed.data(), local.constData(), transformed.size());
+            }
+            transformed.resize(static_cast<int>(size));
+            return '0' + transformed;
+        }
+
         void removeTrackFromDatabase(const QSqlDatabase& db, int id)
         {
             QSqlQuery query(db);
@@ -84,6 +211,15 @@ namespace unplayer
             if (!query.exec()) {
                 qWarning() << "failed to remove file from database" << query.lastQuery();
             }
+
+            if (LibraryUtils::instance()->fullTextSearch() != LibraryUtils::FullTextSearch::None) {
+                QSqlQuery searchQuery(db);
+                searchQuery.prepare(QStringLiteral("DELETE FROM tracks_search WHERE rowid = ?"));
+                searchQuery.addBindValue(id);
+                if (!searchQuery.exec()) {
+                    qWarning() << "failed to remove file from search index" << searchQuery.lastError();
+                }
+            }
         }
 
         void updateTrackInDatabase(const QSqlDatabase& db,
@@ -107,12 +243,26 @@ namespace unplayer
                 }
             };
 
-            forEachOrOnce(info.artists, [&](const QString& artist) {
-                forEachOrOnce(info.albums, [&](const QString& album) {
-                    forEachOrOnce(info.genres, [&](const QString& genre) {
+            QStringList artists(info.artists);
+            artists.removeDuplicates();
+            QStringList albums(info.albums);
+            albums.removeDuplicates();
+            QStringList genres(info.genres);
+            genres.removeDuplicates();
+
+            const QByteArray titleSortKey(sortKey(info.title, false));
+
+            forEachOrOnce(artists, [&](const QString& artist) {
+                const QByteArray artistSortKey(sortKey(artist, true));
+                forEachOrOnce(albums, [&](const QString& album) {
+                    const QByteArray albumSortKey(sortKey(album, true));
+                    // Rows with genreIndex 0 are unique by (id, artist, album)
+                    int genreIndex = 0;
+                    forEachOrOnce(genres, [&](const QString& genre) {
                         QSqlQuery query(db);
-                        query.prepare(QStringLiteral("INSERT INTO tracks (id, filePath, modificationTime, title, artist, album, year, trackNumber, genre, duration, mediaArt) "
-                                                     "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"));
+                        query.prepare(QStringLiteral("INSERT INTO tracks (id, filePath, modificationTime, title, artist, album, year, trackNumber, genre, duration, durationEstimated, "
+                                                     "mediaArt, titleSortKey, artistSortKey, albumSortKey, genreIndex) "
+                                                     "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"));
                         query.addBindValue(id);
                         query.addBindValue(fileInfo.filePath());
                         query.addBindValue(fileInfo.lastModified().toMSecsSinceEpoch());
@@ -143,6 +293,7 @@ namespace unplayer
                         }
 
                         query.addBindValue(info.duration);
+                        query.addBindValue(info.durationEstimated ? 1 : 0);
 
                         if (mediaArt.isEmpty()) {
                             // Empty string instead of NULL
@@ -151,12 +302,32 @@ namespace unplayer
                             query.addBindValue(mediaArt);
                         }
 
+                        query.addBindValue(titleSortKey);
+                        query.addBindValue(artistSortKey);
+                        query.addBindValue(albumSortKey);
+                        query.addBindValue(genreIndex);
+                        ++genreIndex;
+
                         if (!query.exec()) {
                             qWarning() << "failed to insert file in the database" << query.lastError();
                         }
                     });
                 });
             });
+
+            // One search document per track, multiple values are separated by spaces
+            if (LibraryUtils::instance()->fullTextSearch() != LibraryUtils::FullTextSearch::None) {
+                QSqlQuery query(db);
+                query.prepare(QStringLiteral("INSERT INTO tracks_search (rowid, title, artist, album, genre) VALUES (?, ?, ?, ?, ?)"));
+                query.addBindValue(id);
+                query.addBindValue(info.title);
+                query.addBindValue(info.artists.join(QLatin1Char(' ')));
+                query.addBindValue(info.albums.join(QLatin1Char(' ')));
+                query.addBindValue(info.genres.join(QLatin1Char(' ')));
+                if (!query.exec()) {
+                    qWarning() << "failed to insert file in the search index" << query.lastError();
+                }
+            }
         }
     }
 
@@ -235,6 +406,14 @@ namespace unplayer
         return mDatabaseFilePath;
     }
 
+    QSqlDatabase LibraryUtils::readOnlyDatabase()
+    {
+        if (!readOnlyConnections.hasLocalData()) {
+            readOnlyConnections.setLocalData(new ReadOnlyConnection(instance()->databaseFilePath()));
+        }
+        return QSqlDatabase::database(readOnlyConnections.localData()->name, false);
+    }
+
     QString LibraryUtils::findMediaArtForDirectory(QHash<QString, QString>& directoriesHash, const QString& directoryPath)
     {
         if (directoriesHash.contains(directoryPath)) {
@@ -245,12 +424,12 @@ namespace unplayer
         const QStringList found(dir.entryList(QDir::Files | QDir::Readable)
                                 .filter(QRegularExpression(QStringLiteral("^(albumart.*|cover|folder|front)\\.(jpeg|jpg|png)$"),
                                                            QRegularExpression::CaseInsensitiveOption)));
+        QString mediaArt;
         if (!found.isEmpty()) {
-            const QString& mediaArt = dir.filePath(found.first());
-            directoriesHash.insert(directoryPath, mediaArt);
-            return mediaArt;
+            mediaArt = dir.filePath(found.first());
         }
-        return QString();
+        directoriesHash.insert(directoryPath, mediaArt);
+        return mediaArt;
     }
 
     void LibraryUtils::initDatabase()
@@ -270,6 +449,15 @@ namespace unplayer
             return;
         }
 
+        // Readers are not blocked by the rescan transaction in WAL mode
+        {
+            QSqlQuery query(QLatin1String("PRAGMA journal_mode = WAL"));
+            if (!query.next() || query.value(0).toString() != QLatin1String("wal")) {
+                qWarning() << "failed to enable WAL mode:" << query.lastError();
+            }
+        }
+        setConnectionPragmas(db);
+
         bool createTable = !db.tables().contains(QLatin1String("tracks"));
         if (!createTable) {
             static const QVector<QString> fields{QLatin1String("id"),
@@ -282,7 +470,12 @@ namespace unplayer
                                                  QLatin1String("trackNumber"),
                                                  QLatin1String("genre"),
                                                  QLatin1String("duration"),
-                                                 QLatin1String("mediaArt")};
+                                                 QLatin1String("durationEstimated"),
+                                                 QLatin1String("mediaArt"),
+                                                 QLatin1String("titleSortKey"),
+                                                 QLatin1String("artistSortKey"),
+                                                 QLatin1String("albumSortKey"),
+                                                 QLatin1String("genreIndex")};
 
             const QSqlRecord record(db.record(QLatin1String("tracks")));
             if (record.count() == fields.size()) {
@@ -295,6 +488,14 @@ namespace unplayer
                 createTable = true;
             }
 
+            // Sort keys depend on the locale
+            if (!createTable) {
+                QSqlQuery query(QLatin1String("SELECT locale FROM sort_keys_locale"));
+                if (!query.next() || query.value(0).toByteArray() != collationLocale()) {
+                    createTable = true;
+                }
+            }
+
             if (createTable) {
                 QSqlQuery query(QLatin1String("DROP TABLE tracks"));
                 if (query.lastError().type() != QSqlError::NoError) {
@@ -315,7 +516,12 @@ namespace unplayer
                                           "    trackNumber INTEGER,"
                                           "    genre TEXT,"
                                           "    duration INTEGER,"
-                                          "    mediaArt TEXT"
+                                          "    durationEstimated INTEGER,"
+                                          "    mediaArt TEXT,"
+                                          "    titleSortKey BLOB,"
+                                          "    artistSortKey BLOB,"
+                                          "    albumSortKey BLOB,"
+                                          "    genreIndex INTEGER"
                                           ")"));
             if (query.lastError().type() != QSqlError::NoError) {
                 qWarning() << "failed to create table:" << query.lastError();
@@ -323,11 +529,100 @@ namespace unplayer
             }
 
             mCreatedTable = true;
+
+            QSqlQuery localeQuery;
+            if (!localeQuery.exec(QLatin1String("CREATE TABLE IF NOT EXISTS sort_keys_locale (locale TEXT)")) ||
+                    !localeQuery.exec(QLatin1String("DELETE FROM sort_keys_locale"))) {
+                qWarning() << "failed to reset sort keys locale:" << localeQuery.lastError();
+            } else {
+                localeQuery.prepare(QStringLiteral("INSERT INTO sort_keys_locale (locale) VALUES (?)"));
+                localeQuery.addBindValue(QString::fromLatin1(collationLocale()));
+                if (!localeQuery.exec()) {
+                    qWarning() << "failed to save sort keys locale:" << localeQuery.lastError();
+                }
+            }
         }
 
+        // Library queries select rows with genreIndex = 0, so it leads the indexes.
+        // Sort indexes match sort modes of tracks model, including keys that make rows unique,
+        // so that sorted pages are read from them. Artist and album indexes are used to filter
+        // tracks and group albums, albums are then sorted in a temporary B-tree
+        static const QLatin1String indexes[] = {QLatin1String("tracks_id ON tracks (id)"),
+                                                QLatin1String("tracks_file_path ON tracks (filePath)"),
+                                                QLatin1String("tracks_genre_artist_album ON tracks (genreIndex, artist, album)"),
+                                                QLatin1String("tracks_genre_album_artist ON tracks (genreIndex, album, artist)"),
+                                                QLatin1String("tracks_genre_id ON tracks (genreIndex, id, artist, album)"),
+                                                QLatin1String("tracks_genre_title_key ON tracks (genreIndex, titleSortKey, id, artist, album)"),
+                                                QLatin1String("tracks_genre_artist_album_title_key "
+                                                              "ON tracks (genreIndex, artistSortKey, albumSortKey, titleSortKey, id, artist, album)"),
+                                                QLatin1String("tracks_genre_artist_album_number_key "
+                                                              "ON tracks (genreIndex, artistSortKey, albumSortKey, trackNumber, titleSortKey, id, artist, album)"),
+                                                QLatin1String("tracks_genre_artist_year_album_title_key "
+                                                              "ON tracks (genreIndex, artistSortKey, year, albumSortKey, titleSortKey, id, artist, album)"),
+                                                QLatin1String("tracks_genre_artist_year_album_number_key "
+                                                              "ON tracks (genreIndex, artistSortKey, year, albumSortKey, trackNumber, titleSortKey, id, artist, album)")};
+        for (const QLatin1String& index : indexes) {
+            QSqlQuery query;
+            if (!query.exec(QString::fromLatin1("CREATE INDEX IF NOT EXISTS %1").arg(index))) {
+                qWarning() << "failed to create index:" << query.lastError();
+            }
+        }
+
+        initFullTextSearch(db, createTable);
+
         mDatabaseInitialized = true;
     }
 
+    void LibraryUtils::initFullTextSearch(const QSqlDatabase& db, bool recreate)
+    {
+        static const QLatin1String tableName("tracks_search");
+
+        bool createTable = recreate || !db.tables().contains(tableName);
+        if (createTable && db.tables().contains(tableName)) {
+            QSqlQuery query(QLatin1String("DROP TABLE tracks_search"));
+            if (query.lastError().type() != QSqlError::NoError) {
+                qWarning() << "failed to remove search table:" << query.lastError();
+                return;
+            }
+        }
+
+        if (createTable) {
+            // FTS5 may be not compiled in, fall back to FTS4
+            static const QLatin1String modules[] = {QLatin1String("fts5(title, artist, album, genre)"),
+                                                    QLatin1String("fts4(title, artist, album, genre, tokenize=unicode61)"),
+                                                    QLatin1String("fts4(title, artist, album, genre)")};
+            bool created = false;
+            for (const QLatin1String& module : modules) {
+                QSqlQuery query;
+                if (query.exec(QString::fromLatin1("CREATE VIRTUAL TABLE tracks_search USING %1").arg(module))) {
+                    created = true;
+                    break;
+                }
+            }
+            if (!created) {
+                qWarning() << "full-text search is not supported, searching will be slow";
+                return;
+            }
+
+            QSqlQuery query(QLatin1String("INSERT INTO tracks_search (rowid, title, artist, album, genre) "
+                                          "SELECT id, title, group_concat(DISTINCT artist), group_concat(DISTINCT album), group_concat(DISTINCT genre) "
+                                          "FROM tracks GROUP BY id"));
+            if (query.lastError().type() != QSqlError::NoError) {
+                qWarning() << "failed to fill search table:" << query.lastError();
+            }
+        }
+
+        QSqlQuery query(QLatin1String("SELECT sql FROM sqlite_master WHERE name = 'tracks_search'"));
+        if (query.next()) {
+            const QString sql(query.value(0).toString());
+            if (sql.contains(QLatin1String("fts5"), Qt::CaseInsensitive)) {
+                mFullTextSearch = FullTextSearch::Fts5;
+            } else if (sql.contains(QLatin1String("fts4"), Qt::CaseInsensitive)) {
+                mFullTextSearch = FullTextSearch::Fts4;
+            }
+        }
+    }
+
     void LibraryUtils::updateDatabase()
     {
         if (mUpdating) {
@@ -347,6 +642,7 @@ namespace unplayer
                     qWarning() << "failed to open database" << db.lastError();
                     return;
                 }
+                setConnectionPragmas(db);
 
                 db.transaction();
 
@@ -433,7 +729,10 @@ namespace unplayer
                     const auto end = mediaArtHash.end();
                     while (i != end) {
                         const QString& mediaArt = i.value();
-                        if (!mediaArt.isEmpty() && !QFile::exists(mediaArt)) {
+                        // Embedded media art is removed together with its file
+                        if (!mediaArt.isEmpty() &&
+                                !EmbeddedMediaArtProvider::isEmbeddedMediaArtUrl(mediaArt) &&
+                                !QFile::exists(mediaArt)) {
                             QSqlQuery query(db);
                             query.prepare(QStringLiteral("UPDATE tracks SET mediaArt = '' WHERE id = ?"));
                             query.addBindValue(i.key());
@@ -446,18 +745,7 @@ namespace unplayer
                     }
                 }
 
-                QHash<QByteArray, QString> embeddedMediaArtHash;
-                QDir mediaArtDir(mMediaArtDirectory);
-                {
-                    const QList<QFileInfo> files(mediaArtDir.entryInfoList(QDir::Files));
-                    for (const QFileInfo& info : files) {
-                        const QString baseName(info.baseName());
-                        const int index = baseName.indexOf(QLatin1String("-embedded"));
-                        if (index != -1) {
-                            embeddedMediaArtHash.insert(baseName.left(index).toLatin1(), info.filePath());
-                        }
-                    }
-                }
+                const QDir mediaArtDir(mMediaArtDirectory);
 
                 QHash<QString, QString> mediaArtDirectoriesHash;
                 const QMimeDatabase mimeDb;
@@ -514,13 +802,13 @@ namespace unplayer
                                         id = ids.last() + 1;
                                     }
                                     ids.append(id);
+                                    const tagutils::Info info(getTrackInfo(fileInfo, mimeType, mediaArtDirectoriesHash, useDirectoryMediaArt));
                                     updateTrackInDatabase(db,
                                                           false,
                                                           id,
                                                           fileInfo,
-                                                          tagutils::getTrackInfo(fileInfo, mimeType),
-                                                          getTrackMediaArt(tagutils::getTrackInfo(fileInfo, mimeType),
-                                                                           embeddedMediaArtHash,
+                                                          info,
+                                                          getTrackMediaArt(info,
                                                                            fileInfo,
                                                                            mediaArtDirectoriesHash,
                                                                            useDirectoryMediaArt));
@@ -532,10 +820,18 @@ namespace unplayer
                             const long long modificationTime = fileInfo.lastModified().toMSecsSinceEpoch();
                             if (modificationTime == modificationTimeHash.value(id)) {
                                 const QString mediaArt(mediaArtHash.value(id));
-                                if (!mediaArt.startsWith(mMediaArtDirectory) ||
-                                        (QFileInfo(mediaArt).fileName().contains(QLatin1String("-embedded")) && useDirectoryMediaArt)) {
-                                    const QString newMediaArt(getTrackMediaArt(tagutils::getTrackInfo(fileInfo, mimeDb.mimeTypeForFile(filePath, QMimeDatabase::MatchContent).name()),
-                                                                               embeddedMediaArtHash,
+                                const bool embedded = EmbeddedMediaArtProvider::isEmbeddedMediaArtUrl(mediaArt);
+                                // Media art extracted to the cache directory by older versions
+                                const bool extracted = mediaArt.startsWith(mMediaArtDirectory) &&
+                                                       QFileInfo(mediaArt).fileName().contains(QLatin1String("-embedded"));
+                                if ((!mediaArt.startsWith(mMediaArtDirectory) && !embedded) ||
+                                        extracted ||
+                                        (embedded && useDirectoryMediaArt)) {
+                                    const tagutils::Info info(getTrackInfo(fileInfo,
+                                                                           mimeDb.mimeTypeForFile(filePath, QMimeDatabase::MatchContent).name(),
+                                                                           mediaArtDirectoriesHash,
+                                                                           useDirectoryMediaArt));
+                                    const QString newMediaArt(getTrackMediaArt(info,
                                                                                fileInfo,
                                                                                mediaArtDirectoriesHash,
                                                                                useDirectoryMediaArt));
@@ -551,13 +847,13 @@ namespace unplayer
                                 const QString mimeType(mimeDb.mimeTypeForFile(filePath, QMimeDatabase::MatchContent).name());
                                 if (mimeTypesByContent.contains(mimeType)) {
                                     ids.append(ids.last() + 1);
+                                    const tagutils::Info info(getTrackInfo(fileInfo, mimeType, mediaArtDirectoriesHash, useDirectoryMediaArt));
                                     updateTrackInDatabase(db,
                                                           true,
                                                           ids.last(),
                                                           fileInfo,
-                                                          tagutils::getTrackInfo(fileInfo, mimeType),
-                                                          getTrackMediaArt(tagutils::getTrackInfo(fileInfo, mimeType),
-                                                                           embeddedMediaArtHash,
+                                                          info,
+                                                          getTrackMediaArt(info,
                                                                            fileInfo,
                                                                            mediaArtDirectoriesHash,
                                                                            useDirectoryMediaArt));
@@ -591,6 +887,81 @@ namespace unplayer
                 }
 
                 db.commit();
+
+                if (Settings::instance()->accurateDuration()) {
+                    // Tracks whose duration should be corrected, including those
+                    // left over from previous scans that were interrupted
+                    struct EstimatedDurationTrack
+                    {
+                        int id;
+                        QString filePath;
+                        int duration;
+                    };
+                    QVector<EstimatedDurationTrack> estimatedDurationTracks;
+                    {
+                        QSqlQuery query(QLatin1String("SELECT id, filePath, duration FROM tracks WHERE durationEstimated = 1 GROUP BY id"), db);
+                        if (query.lastError().type() == QSqlError::NoError) {
+                            while (query.next()) {
+                                estimatedDurationTracks.append({query.value(0).toInt(),
+                                                                query.value(1).toString(),
+                                                                query.value(2).toInt()});
+                            }
+                        } else {
+                            qWarning() << "failed to get tracks with estimated duration" << query.lastError();
+                        }
+                    }
+
+                    if (!estimatedDurationTracks.isEmpty()) {
+                        // Show scanned tracks while walking through MPEG frames
+                        QMetaObject::invokeMethod(this, "databaseChanged", Qt::QueuedConnection);
+
+                        qDebug() << "start calculating duration of" << estimatedDurationTracks.size() << "tracks";
+
+                        // Committed in small batches, so that database is not locked
+                        // for the whole pass and corrected durations are shown as they come
+                        const int batchSize = 20;
+                        int batchUpdated = 0;
+                        int batchProcessed = 0;
+
+                        QSqlQuery query(db);
+                        db.transaction();
+                        query.prepare(QStringLiteral("UPDATE tracks SET duration = ?, durationEstimated = 0 WHERE id = ?"));
+                        for (const EstimatedDurationTrack& track : estimatedDurationTracks) {
+                            if (!qApp) {
+                                qWarning() << "app shutdown, stop calculating duration";
+                                break;
+                            }
+
+                            // Estimated duration is kept if it can't be calculated,
+                            // so that the track is not walked through on every scan
+                            int duration = tagutils::getAccurateMpegDuration(track.filePath);
+                            if (duration <= 0) {
+                                duration = track.duration;
+                            }
+                            query.addBindValue(duration);
+                            query.addBindValue(track.id);
+                            if (query.exec()) {
+                                if (duration != track.duration) {
+                                    ++batchUpdated;
+                                }
+                            } else {
+                                qWarning() << "failed to update track duration" << query.lastError();
+                            }
+
+                            ++batchProcessed;
+                            if (batchProcessed == batchSize) {
+                                db.commit();
+                                if (batchUpdated > 0) {
+                                    QMetaObject::invokeMethod(this, "databaseChanged", Qt::QueuedConnection);
+                                }
+                                batchUpdated = 0;
+                                batchProcessed = 0;
+                                db.transaction();
+                            }
+                        }
+                        db.commit();
+                    }
+                }
             }
             QSqlDatabase::removeDatabase(rescanConnectionName);
             qDebug() << "end scanning files";
@@ -611,6 +982,11 @@ namespace unplayer
         if (query.lastError().type() != QSqlError::NoError) {
             qWarning() << "failed to reset database";
         }
+        if (mFullTextSearch != FullTextSearch::None) {
+            if (!query.exec(QLatin1String("DELETE from tracks_search"))) {
+                qWarning() << "failed to reset search index";
+            }
+        }
         if (!QDir(mMediaArtDirectory).removeRecursively()) {
             qWarning() << "failed to remove media art directory";
         }
@@ -632,6 +1008,29 @@ namespace unplayer
         return mUpdating;
     }
 
+    LibraryUtils::FullTextSearch LibraryUtils::fullTextSearch() const
+    {
+        return mFullTextSearch;
+    }
+
+    QString LibraryUtils::fullTextSearchQuery(const QString& text) const
+    {
+        // Every word must match the beginning of some token in any column
+        QStringList terms;
+        for (QString word : text.split(QRegularExpression(QLatin1String("\\s+")), QString::SkipEmptyParts)) {
+            word.remove(QLatin1Char('"'));
+            if (word.isEmpty()) {
+                continue;
+            }
+            if (mFullTextSearch == FullTextSearch::Fts5) {
+                terms.append(QString::fromLatin1("\"%1\"*").arg(word));
+            } else {
+                terms.append(QString::fromLatin1("\"%1*\"").arg(word));
+            }
+        }
+        return terms.join(QLatin1Char(' '));
+    }
+
     int LibraryUtils::artistsCount()
     {
         if (!mDatabaseInitialized) {
@@ -771,58 +1170,11 @@ namespace unplayer
         : mDatabaseInitialized(false),
           mCreatedTable(false),
           mUpdating(false),
+          mFullTextSearch(FullTextSearch::None),
           mDatabaseFilePath(QString::fromLatin1("%1/library.sqlite").arg(QStandardPaths::writableLocation(QStandardPaths::DataLocation))),
           mMediaArtDirectory(QString::fromLatin1("%1/media-art").arg(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)))
     {
         initDatabase();
         QObject::connect(this, &LibraryUtils::databaseChanged, this, &LibraryUtils::mediaArtChanged);
     }
-
-    QString LibraryUtils::getTrackMediaArt(const tagutils::Info& info,
-                                           QHash<QByteArray, QString>& embeddedMediaArtHash,
-                                           const QFileInfo& fileInfo,
-                                           QHash<QString, QString>& directoriesHash,
-                                           bool useDirectoriesMediaArt)
-    {
-        QString mediaArt;
-        if (useDirectoriesMediaArt) {
-            mediaArt = findMediaArtForDirectory(directoriesHash, fileInfo.path());
-            if (mediaArt.isEmpty()) {
-                if (!info.mediaArtData.isEmpty()) {
-                    mediaArt = saveEmbeddedMediaArt(info.mediaArtData, embeddedMediaArtHash);
-                }
-            }
-        } else {
-            if (info.mediaArtData.isEmpty()) {
-                mediaArt = findMediaArtForDirectory(directoriesHash, fileInfo.path());
-            } else {
-                mediaArt = saveEmbeddedMediaArt(info.mediaArtData, embeddedMediaArtHash);
-            }
-        }
-        return mediaArt;
-    }
-
-    QString LibraryUtils::saveEmbeddedMediaArt(const QByteArray& data, QHash<QByteArray, QString>& embeddedMediaArtHash)
-    {
-        const QByteArray md5(QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex());
-        if (embeddedMediaArtHash.contains(md5)) {
-            return embeddedMediaArtHash.value(md5);
-        }
-
-        const QString suffix(mMimeDb.mimeTypeForData(data).preferredSuffix());
-        if (suffix.isEmpty()) {
-            return QString();
-        }
-
-        const QString filePath(QString::fromLatin1("%1/%2-embedded.%3")
-                               .arg(mMediaArtDirectory, QString::fromLatin1(md5), suffix));
-        QFile file(filePath);
-        if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-            file.write(data);
-            embeddedMediaArtHash.insert(md5, filePath);
-            return filePath;
-        }
-
-        return QString();
-    }
 }
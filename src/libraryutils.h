@@ -21,17 +21,12 @@
 
 #include <QMimeDatabase>
 #include <QObject>
+#include <QStringList>
 
-class QFileInfo;
 class QSqlDatabase;
 
 namespace unplayer
 {
-    namespace tagutils
-    {
-        struct Info;
-    }
-
     enum class MimeType
     {
         Flac,
@@ -50,6 +45,20 @@ namespace unplayer
 
     MimeType mimeTypeFromString(const QString& string);
 
+    // Track as it is stored in library, with everything that queue needs
+    // so that it doesn't look it up again
+    struct LibraryTrack
+    {
+        int id;
+        QString filePath;
+        long long modificationTime;
+        QString title;
+        QStringList artists;
+        QStringList albums;
+        int duration;
+        QString mediaArt;
+    };
+
     class LibraryUtils : public QObject
     {
         Q_OBJECT
@@ -62,12 +71,22 @@ namespace unplayer
         Q_PROPERTY(int tracksDuration READ tracksDuration NOTIFY databaseChanged)
         Q_PROPERTY(QString randomMediaArt READ randomMediaArt NOTIFY mediaArtChanged)
     public:
+        enum class FullTextSearch
+        {
+            None,
+            Fts4,
+            Fts5
+        };
+
         static const QVector<QString> mimeTypesByExtension;
         static const QVector<QString> mimeTypesByContent;
         static LibraryUtils* instance();
 
         const QString& databaseFilePath();
 
+        // Read-only connection owned by the calling thread, reused by later queries on it
+        static QSqlDatabase readOnlyDatabase();
+
         static QString findMediaArtForDirectory(QHash<QString, QString>& directoriesHash, const QString& directoryPath);
 
         void initDatabase();
@@ -78,6 +97,9 @@ namespace unplayer
         bool isCreatedTable();
         bool isUpdating();
 
+        FullTextSearch fullTextSearch() const;
+        QString fullTextSearchQuery(const QString& text) const;
+
         int artistsCount();
         int albumsCount();
         int tracksCount();
@@ -90,20 +112,15 @@ namespace unplayer
     private:
         LibraryUtils();
 
-        QString getTrackMediaArt(const tagutils::Info& info,
-                                 QHash<QByteArray, QString>& embeddedMediaArtHash,
-                                 const QFileInfo& fileInfo,
-                                 QHash<QString, QString>& directoriesHash,
-                                 bool useDirectoriesMediaArt);
-        QString saveEmbeddedMediaArt(const QByteArray& data, QHash<QByteArray, QString>& embeddedMediaArtHash);
+        void initFullTextSearch(const QSqlDatabase& db, bool recreate);
 
         bool mDatabaseInitialized;
         bool mCreatedTable;
         bool mUpdating;
+        FullTextSearch mFullTextSearch;
 
         QString mDatabaseFilePath;
         QString mMediaArtDirectory;
-        QMimeDatabase mMimeDb;
     signals:
         void updatingChanged();
         void databaseChanged();
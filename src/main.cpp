@@ -30,6 +30,7 @@
 
 #include <sailfishapp.h>
 
+#include "embeddedmediaartprovider.h"
 #include "libraryutils.h"
 #include "player.h"
 #include "queue.h"
@@ -68,6 +69,7 @@ int main(int argc, char* argv[])
     LibraryUtils::instance();
     Utils::registerTypes();
 
+    view->engine()->addImageProvider(EmbeddedMediaArtProvider::providerId, new EmbeddedMediaArtProvider());
     view->engine()->addImageProvider(QueueImageProvider::providerId, new QueueImageProvider(Player::instance()->queue()));
 
     view->setSource(SailfishApp::pathTo(QLatin1String("qml/main.qml")));
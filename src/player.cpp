@@ -20,11 +20,13 @@
 
 #include <QCoreApplication>
 #include <QDebug>
+#include <QTimer>
 #include <QUrl>
 
 #include <MprisPlayer>
 
 #include "queue.h"
+#include "queuestore.h"
 #include "settings.h"
 
 namespace unplayer
@@ -54,16 +56,11 @@ namespace unplayer
 
     void Player::saveState() const
     {
-        QStringList tracks;
-        tracks.reserve(mQueue->tracks().size());
-        for (const auto& track : mQueue->tracks()) {
-            tracks.append(track->filePath);
-        }
-        Settings::instance()->savePlayerState(tracks,
-                                              mQueue->currentIndex(),
-                                              mQueue->isShuffle(),
-                                              mQueue->repeatMode(),
-                                              position());
+        // Tracks and current index are already stored as they change
+        mSaveStateTimer->stop();
+        mShuffleOrderChanged = true;
+        saveQueueState();
+        Settings::instance()->savePlayerState(mQueue->isShuffle(), mQueue->repeatMode());
     }
 
     void Player::restoreState()
@@ -71,14 +68,43 @@ namespace unplayer
         mRestoringState = true;
         mQueue->setShuffle(Settings::instance()->shuffle());
         mQueue->setRepeatMode(Settings::instance()->repeatMode());
-        mQueue->addTracks(Settings::instance()->queueTracks(), true, Settings::instance()->queuePosition());
+
+        const QueueStore::State state(mQueueStore->loadState());
+        if (state.saved) {
+            mRestoredPosition = state.position;
+            mQueue->restoreShuffleOrder(state.shuffleOrder, state.shuffleIndex);
+            // Tracks are loaded in store thread, and then queue is written again
+            // from scratch, which also compacts it
+            const QFuture<QVector<std::shared_ptr<QueueTrack>>> tracks(mQueueStore->loadTracks());
+            mQueue->restoreTracks([tracks]() {
+                return tracks.result();
+            }, state.currentIndex);
+        } else {
+            mRestoredPosition = Settings::instance()->playerPosition();
+            mQueue->addTracks(Settings::instance()->queueTracks(), true, Settings::instance()->queuePosition());
+        }
+    }
+
+    void Player::saveQueueState() const
+    {
+        mQueueStore->savePosition(position());
+        if (mShuffleOrderChanged) {
+            int shuffleIndex;
+            const QVector<int> shuffleOrder(mQueue->shuffleOrder(shuffleIndex));
+            mQueueStore->saveShuffleOrder(shuffleOrder, shuffleIndex);
+            mShuffleOrderChanged = false;
+        }
     }
 
     Player::Player(QObject* parent)
         : QMediaPlayer(parent),
           mQueue(new Queue(this)),
+          mQueueStore(new QueueStore(mQueue, this)),
+          mSaveStateTimer(new QTimer(this)),
+          mShuffleOrderChanged(false),
           mSettingNewTrack(false),
-          mRestoringState(false)
+          mRestoringState(false),
+          mRestoredPosition(0)
     {
         auto mpris = new MprisPlayer(this);
         mpris->setServiceName(QLatin1String("unplayer"));
@@ -94,6 +120,11 @@ namespace unplayer
                 if (newState == PlayingState || oldState == PlayingState) {
                     emit playingChanged();
                 }
+                if (oldState == PlayingState) {
+                    // Save position where playback stopped
+                    mSaveStateTimer->stop();
+                    saveQueueState();
+                }
                 oldState = newState;
 
                 switch (newState) {
@@ -109,6 +140,28 @@ namespace unplayer
             }
         });
 
+        // Position and shuffle order are saved as they change, but not more often than every 5 seconds
+        mSaveStateTimer->setInterval(5000);
+        mSaveStateTimer->setSingleShot(true);
+        QObject::connect(mSaveStateTimer, &QTimer::timeout, this, &Player::saveQueueState);
+
+        const auto scheduleSaveState = [=]() {
+            if (!mSaveStateTimer->isActive()) {
+                mSaveStateTimer->start();
+            }
+        };
+        QObject::connect(this, &Player::positionChanged, this, scheduleSaveState);
+
+        const auto shuffleOrderChanged = [=]() {
+            mShuffleOrderChanged = true;
+            scheduleSaveState();
+        };
+        QObject::connect(mQueue, &Queue::tracksAdded, this, shuffleOrderChanged);
+        QObject::connect(mQueue, &Queue::tracksRemoved, this, shuffleOrderChanged);
+        QObject::connect(mQueue, &Queue::cleared, this, shuffleOrderChanged);
+        QObject::connect(mQueue, &Queue::currentIndexChanged, this, shuffleOrderChanged);
+        QObject::connect(mQueue, &Queue::shuffleChanged, this, shuffleOrderChanged);
+
         QObject::connect(this, &Player::mediaStatusChanged, this, [=](MediaStatus status) {
             if (status == EndOfMedia) {
                 mQueue->nextOnEos();
@@ -125,7 +178,6 @@ namespace unplayer
                 mpris->setCanPause(false);
                 mpris->setCanGoNext(false);
                 mpris->setCanGoPrevious(false);
-                mpris->setMetadata(QVariantMap());
             } else {
                 const QueueTrack* track = mQueue->tracks().at(mQueue->currentIndex()).get();
 
@@ -134,7 +186,7 @@ namespace unplayer
                 mSettingNewTrack = false;
 
                 if (mRestoringState) {
-                    setPosition(Settings::instance()->playerPosition());
+                    setPosition(mRestoredPosition);
                     mRestoringState = false;
                 } else {
                     play();
@@ -144,6 +196,14 @@ namespace unplayer
                 mpris->setCanPause(true);
                 mpris->setCanGoNext(true);
                 mpris->setCanGoPrevious(true);
+            }
+        });
+
+        QObject::connect(mQueue, &Queue::currentMetadataChanged, this, [=]() {
+            if (mQueue->currentIndex() == -1) {
+                mpris->setMetadata(QVariantMap());
+            } else {
+                const QueueTrack* track = mQueue->tracks().at(mQueue->currentIndex()).get();
                 mpris->setMetadata({{Mpris::metadataToString(Mpris::Title), track->title},
                                     {Mpris::metadataToString(Mpris::Artist), track->artist},
                                     {Mpris::metadataToString(Mpris::Album), track->album}});
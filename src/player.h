@@ -21,9 +21,12 @@
 
 #include <QMediaPlayer>
 
+class QTimer;
+
 namespace unplayer
 {
     class Queue;
+    class QueueStore;
 
     class Player : public QMediaPlayer
     {
@@ -41,11 +44,16 @@ namespace unplayer
 
     private:
         Player(QObject* parent);
+        void saveQueueState() const;
 
         Queue* mQueue;
+        QueueStore* mQueueStore;
+        QTimer* mSaveStateTimer;
+        mutable bool mShuffleOrderChanged;
         bool mSettingNewTrack;
 
         bool mRestoringState;
+        long long mRestoredPosition;
 
     signals:
         void playingChanged();
@@ -26,12 +26,15 @@
 
 #include <QFileInfo>
 #include <QUrl>
+#include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QSettings>
 
 #include <QFile>
 
+#include "libraryutils.h"
+
 namespace unplayer
 {
     namespace
@@ -65,7 +68,8 @@ namespace unplayer
             QString title;
             bool inLibrary = false;
 
-            QSqlQuery query;
+            // Also called from worker threads
+            QSqlQuery query(LibraryUtils::readOnlyDatabase());
             query.prepare(QLatin1String("SELECT title, duration, artist, album FROM tracks WHERE filePath = ?"));
             query.addBindValue(filePath);
             if (query.exec()) {
@@ -243,7 +247,8 @@ namespace unplayer
             QSettings settings(filePath, QSettings::IniFormat);
             settings.beginGroup(QLatin1String("playlist"));
 
-            QSqlDatabase::database().transaction();
+            QSqlDatabase db(LibraryUtils::readOnlyDatabase());
+            db.transaction();
             for (int i = 1, max = settings.childKeys().filter(QLatin1String("File")).size() + 1; i < max; ++i) {
                 QString filePath;
                 {
@@ -282,7 +287,7 @@ namespace unplayer
 
                 tracks.append(track);
             }
-            QSqlDatabase::database().commit();
+            db.commit();
 
             settings.endGroup();
             break;
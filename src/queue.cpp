@@ -23,14 +23,20 @@
 #include <QCoreApplication>
 #include <QDateTime>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QFileInfo>
 #include <QFutureWatcher>
 #include <QMimeDatabase>
+#include <QMutexLocker>
+#include <QSet>
 #include <QSqlError>
 #include <QSqlQuery>
 #include <QSqlDatabase>
 #include <QSqlRecord>
+#include <QThread>
+#include <QtConcurrentMap>
 #include <QtConcurrentRun>
+#include <QThreadPool>
 
 #include "libraryutils.h"
 #include "playlistutils.h"
@@ -41,58 +47,320 @@ namespace unplayer
 {
     namespace
     {
-        const QString dbConnectionName(QLatin1String("unplayer_queue"));
+        struct TrackInfo
+        {
+            bool exists = true;
+            long long modificationTime = 0;
+            QString title;
+            QStringList artists;
+            QStringList albums;
+            int duration = 0;
+            QString mediaArtFilePath;
+            QByteArray mediaArtKey;
+            long long mediaArtOffset = -1;
+            long long mediaArtLength = 0;
+        };
+
+        struct TagsJob
+        {
+            QString filePath;
+            QString directoryMediaArt;
+            bool useDirectoryMediaArt;
+        };
+
+        // Library tracks of given files, with one query per chunk of paths
+        QHash<QString, TrackInfo> getLibraryTracks(const QStringList& filePaths)
+        {
+            QHash<QString, TrackInfo> tracks;
+
+            const QSqlDatabase db(LibraryUtils::readOnlyDatabase());
+            if (!db.isOpen()) {
+                return tracks;
+            }
+
+            // Default SQLite limit of bound values
+            const int chunkSize = 999;
+            for (int chunkStart = 0, max = filePaths.size(); chunkStart < max; chunkStart += chunkSize) {
+                const int chunkEnd = std::min(chunkStart + chunkSize, max);
+
+                QStringList placeholders;
+                placeholders.reserve(chunkEnd - chunkStart);
+                for (int i = chunkStart; i < chunkEnd; ++i) {
+                    placeholders.append(QStringLiteral("?"));
+                }
+
+                QSqlQuery query(db);
+                query.setForwardOnly(true);
+                query.prepare(QString::fromLatin1("SELECT filePath, modificationTime, title, artist, album, duration, mediaArt FROM tracks "
+                                                  "WHERE filePath IN (%1)").arg(placeholders.join(QLatin1String(", "))));
+                for (int i = chunkStart; i < chunkEnd; ++i) {
+                    query.addBindValue(filePaths.at(i));
+                }
+                if (!query.exec()) {
+                    qWarning() << "failed to get tracks from database" << query.lastError();
+                    break;
+                }
+
+                // Track has a row for each artist, album and genre
+                while (query.next()) {
+                    const QString filePath(query.value(0).toString());
+                    auto track(tracks.find(filePath));
+                    if (track == tracks.end()) {
+                        track = tracks.insert(filePath, TrackInfo());
+                        track->modificationTime = query.value(1).toLongLong();
+                        track->title = query.value(2).toString();
+                        track->duration = query.value(5).toInt();
+                        track->mediaArtFilePath = query.value(6).toString();
+                    }
+                    track->artists.append(query.value(3).toString());
+                    track->albums.append(query.value(4).toString());
+                }
+            }
+
+            for (TrackInfo& track : tracks) {
+                track.artists.removeDuplicates();
+                track.artists.removeAll(QString());
+                track.albums.removeDuplicates();
+                track.albums.removeAll(QString());
+            }
+
+            return tracks;
+        }
+
+        std::shared_ptr<QueueTrack> makeTrack(const QString& filePath,
+                                              long long modificationTime,
+                                              const QString& title,
+                                              int duration,
+                                              const QStringList& artists,
+                                              const QStringList& albums,
+                                              const QString& mediaArtFilePath,
+                                              const QByteArray& mediaArtKey,
+                                              long long mediaArtOffset,
+                                              long long mediaArtLength)
+        {
+            QString artist;
+            if (artists.isEmpty()) {
+                artist = qApp->translate("unplayer", "Unknown artist");
+            } else {
+                artist = artists.join(QLatin1String(", "));
+            }
+
+            QString album;
+            if (albums.isEmpty()) {
+                album = qApp->translate("unplayer", "Unknown artist");
+            } else {
+                album = albums.join(QLatin1String(", "));
+            }
+
+            return std::make_shared<QueueTrack>(filePath,
+                                                modificationTime,
+                                                title,
+                                                duration,
+                                                artist,
+                                                album,
+                                                mediaArtFilePath,
+                                                mediaArtKey,
+                                                mediaArtOffset,
+                                                mediaArtLength);
+        }
+
+        // Picture is not read, its key is computed when it is located
+        void setEmbeddedMediaArt(const tagutils::Info& info, TrackInfo& track)
+        {
+            track.mediaArtKey = info.mediaArtKey;
+            track.mediaArtOffset = info.mediaArtOffset;
+            track.mediaArtLength = info.mediaArtLength;
+        }
+
+        // Called from multiple threads
+        TrackInfo readTags(const TagsJob& job)
+        {
+            TrackInfo track;
+
+            const QFileInfo fileInfo(job.filePath);
+            if (!fileInfo.exists()) {
+                track.exists = false;
+                return track;
+            }
+
+            const tagutils::Info info(tagutils::getTrackInfo(fileInfo, QMimeDatabase().mimeTypeForFile(job.filePath, QMimeDatabase::MatchContent).name()));
+            track.modificationTime = fileInfo.lastModified().toMSecsSinceEpoch();
+            track.title = info.title;
+            track.artists = info.artists;
+            track.albums = info.albums;
+            track.duration = info.duration;
+            if (job.useDirectoryMediaArt) {
+                track.mediaArtFilePath = job.directoryMediaArt;
+                if (track.mediaArtFilePath.isEmpty() && info.hasMediaArt) {
+                    setEmbeddedMediaArt(info, track);
+                }
+            } else {
+                if (info.hasMediaArt) {
+                    setEmbeddedMediaArt(info, track);
+                } else {
+                    track.mediaArtFilePath = job.directoryMediaArt;
+                }
+            }
+
+            return track;
+        }
+
+        // Metadata from library, tags are read for files that are not in the library or were changed since the last scan
+        QHash<QString, TrackInfo> getTracksInfo(const QStringList& filePaths)
+        {
+            QHash<QString, TrackInfo> infos(getLibraryTracks(filePaths));
+
+            QVector<TagsJob> tagsJobs;
+            {
+                const bool useDirectoryMediaArt = Settings::instance()->useDirectoryMediaArt();
+                QHash<QString, QString> mediaArtDirectoriesHash;
+                for (const QString& filePath : filePaths) {
+                    const QFileInfo fileInfo(filePath);
+                    const auto found(infos.constFind(filePath));
+                    if (found == infos.constEnd() || found->modificationTime != fileInfo.lastModified().toMSecsSinceEpoch()) {
+                        // Directories hash is not thread-safe, look for media art here
+                        tagsJobs.append({filePath,
+                                         LibraryUtils::findMediaArtForDirectory(mediaArtDirectoriesHash, fileInfo.path()),
+                                         useDirectoryMediaArt});
+                    }
+                }
+            }
+            if (!tagsJobs.isEmpty()) {
+                const QVector<TrackInfo> tagsInfos(QtConcurrent::blockingMapped<QVector<TrackInfo>>(tagsJobs, readTags));
+                for (int i = 0, max = tagsJobs.size(); i < max; ++i) {
+                    infos.insert(tagsJobs.at(i).filePath, tagsInfos.at(i));
+                }
+            }
+
+            return infos;
+        }
+
+        // Created tracks are reported in chunks, so that queue is populated while the rest
+        // are resolved. First chunk is a single track, then size follows measured throughput
+        // so that chunk takes about 50 ms. It is kept between the number of threads that
+        // parse tags in parallel and 200 tracks
+        class TracksReporter
+        {
+        public:
+            explicit TracksReporter(QFutureInterface<std::shared_ptr<QueueTrack>>& future, int count)
+                : mFuture(future),
+                  mChunkSize(1),
+                  mProcessed(0)
+            {
+                mFuture.setProgressRange(0, count);
+                mTimer.start();
+            }
+
+            int chunkSize() const
+            {
+                return mChunkSize;
+            }
+
+            void add(const std::shared_ptr<QueueTrack>& track)
+            {
+                mTracks.append(track);
+            }
+
+            // processed is the number of paths processed so far
+            void report(int processed)
+            {
+                if (!mTracks.isEmpty()) {
+                    mFuture.reportResults(mTracks);
+                    mTracks.clear();
+                }
+                mFuture.setProgressValue(processed);
+
+                const long long chunkDuration = 50;
+                const int maxChunkSize = 200;
+                const int minChunkSize = std::min(std::max(QThread::idealThreadCount(), 1), maxChunkSize);
+                const long long elapsed = mTimer.restart();
+                const long long count = processed - mProcessed;
+                mProcessed = processed;
+                if (elapsed > 0) {
+                    mChunkSize = static_cast<int>(std::max<long long>(std::min<long long>(count * chunkDuration / elapsed, maxChunkSize), minChunkSize));
+                } else {
+                    mChunkSize = maxChunkSize;
+                }
+            }
+
+        private:
+            QFutureInterface<std::shared_ptr<QueueTrack>>& mFuture;
+            int mChunkSize;
+            int mProcessed;
+            QVector<std::shared_ptr<QueueTrack>> mTracks;
+            QElapsedTimer mTimer;
+        };
+
+        std::shared_ptr<QueueTrack> makeTrack(const QString& filePath, const TrackInfo& info)
+        {
+            return makeTrack(filePath,
+                             info.modificationTime,
+                             info.title,
+                             info.duration,
+                             info.artists,
+                             info.albums,
+                             info.mediaArtFilePath,
+                             info.mediaArtKey,
+                             info.mediaArtOffset,
+                             info.mediaArtLength);
+        }
     }
 
     QueueTrack::QueueTrack(const QString& filePath,
+                           long long modificationTime,
                            const QString& title,
                            int duration,
                            const QString& artist,
                            const QString& album,
                            const QString& mediaArt,
-                           const QByteArray& mediaArtData)
+                           const QByteArray& mediaArtKey,
+                           long long mediaArtOffset,
+                           long long mediaArtLength)
         : filePath(filePath),
+          modificationTime(modificationTime),
           title(title),
           duration(duration),
           artist(artist),
           album(album),
-          mediaArtFilePath(mediaArt)
+          mediaArtFilePath(mediaArt),
+          mediaArtKey(mediaArtKey),
+          mediaArtOffset(mediaArtOffset),
+          mediaArtLength(mediaArtLength)
     {
-        mediaArtPixmap.loadFromData(mediaArtData);
+
     }
 
     Queue::Queue(QObject* parent)
         : QObject(parent),
+          mNextTrackId(0),
+          mTrackPositionsValid(true),
+          mShuffleIndex(-1),
+          mRestoredShuffleIndex(-1),
           mCurrentIndex(-1),
           mShuffle(false),
           mRepeatMode(NoRepeat),
-          mAddingTracks(false)
-    {
-        QObject::connect(LibraryUtils::instance(), &LibraryUtils::mediaArtChanged, this, [=]() {
-            QSqlDatabase::database().transaction();
-            for (const std::shared_ptr<QueueTrack>& track : mTracks) {
-                QSqlQuery query;
-                query.prepare(QStringLiteral("SELECT mediaArt FROM tracks WHERE filePath = ?"));
-                query.addBindValue(track->filePath);
-                if (query.exec()) {
-                    if (query.next()) {
-                        track->mediaArtFilePath = query.value(0).toString();
-                    }
-                } else {
-                    qWarning() << "failed to get media art from database for track:" << track->filePath;
-                }
-            }
-            QSqlDatabase::database().commit();
-            emit mediaArtChanged();
-        });
+          mAddingTracks(false),
+          mAddingTracksProgress(0.0),
+          mUpdatingMediaArt(false),
+          mMediaArtUpdatePending(false),
+          mMediaArt(std::make_shared<QueueMediaArt>(Settings::instance()->queueMediaArtCacheSize()))
+    {
+
+        QObject::connect(LibraryUtils::instance(), &LibraryUtils::mediaArtChanged, this, &Queue::updateMediaArt);
+        QObject::connect(this, &Queue::currentTrackChanged, this, &Queue::currentMetadataChanged);
         QObject::connect(this, &Queue::currentTrackChanged, this, &Queue::mediaArtChanged);
     }
 
-    const QList<std::shared_ptr<QueueTrack>>& Queue::tracks() const
+    const QVector<std::shared_ptr<QueueTrack>>& Queue::tracks() const
     {
         return mTracks;
     }
 
+    const QVector<int>& Queue::trackIds() const
+    {
+        return mTrackIds;
+    }
+
     int Queue::currentIndex() const
     {
         return mCurrentIndex;
@@ -145,8 +413,8 @@ namespace unplayer
             if (!track->mediaArtFilePath.isEmpty()) {
                 return track->mediaArtFilePath;
             }
-            if (!track->mediaArtPixmap.isNull()) {
-                return QString::fromLatin1("image://%1/%2").arg(QueueImageProvider::providerId, track->filePath);
+            if (!track->mediaArtKey.isEmpty()) {
+                return QString::fromLatin1("image://%1/%2").arg(QueueImageProvider::providerId, QString::fromLatin1(track->mediaArtKey.toHex()));
             }
         }
         return QString();
@@ -162,7 +430,7 @@ namespace unplayer
         if (shuffle != mShuffle) {
             mShuffle = shuffle;
             emit shuffleChanged();
-            if (!mShuffle) {
+            if (mShuffle) {
                 resetNotPlayedTracks();
             }
         }
@@ -202,36 +470,33 @@ namespace unplayer
         return mAddingTracks;
     }
 
+    double Queue::addingTracksProgress() const
+    {
+        return mAddingTracksProgress;
+    }
+
     void Queue::addTrack(const QString& track)
     {
-        addTracks({track});
+        addTracks(QStringList{track});
     }
 
     void Queue::addTracks(const QStringList& trackPaths, bool clearQueue, int setAsCurrent)
     {
-        if (mAddingTracks) {
-            return;
-        }
-
         if (trackPaths.isEmpty()) {
             return;
         }
 
-        mAddingTracks = true;
-        emit addingTracksChanged();
-
-        const QList<std::shared_ptr<QueueTrack>> oldTracks(mTracks);
-
-        if (clearQueue) {
-            clear();
-        }
-
-        auto future = QtConcurrent::run([trackPaths, oldTracks]() {
-            QList<std::shared_ptr<QueueTrack>> tracks;
+        addTracks([trackPaths]() {
+            return trackPaths;
+        }, clearQueue, setAsCurrent);
+    }
 
+    void Queue::addTracks(const std::function<QStringList()>& getTrackPaths, bool clearQueue, int setAsCurrent)
+    {
+        addQueueTracks([getTrackPaths](const QVector<std::shared_ptr<QueueTrack>>& oldTracks, QFutureInterface<std::shared_ptr<QueueTrack>>& future) {
             const QMimeDatabase mimeDb;
 
-            QStringList newTrackPaths(trackPaths);
+            QStringList newTrackPaths(getTrackPaths());
             for (int i = 0, max = newTrackPaths.size(); i < max; ++i) {
                 const QString filePath(newTrackPaths.at(i));
                 if (PlaylistUtils::playlistsMimeTypes.contains(mimeDb.mimeTypeForFile(filePath, QMimeDatabase::MatchExtension).name())) {
@@ -247,160 +512,203 @@ namespace unplayer
                 }
             }
 
-            {
-                auto db = QSqlDatabase::addDatabase(QLatin1String("QSQLITE"), dbConnectionName);
-                db.setDatabaseName(LibraryUtils::instance()->databaseFilePath());
-                if (!db.open()) {
-                    qWarning() << "failed to open database" << db.lastError();
-                }
+            // Tracks that are already in the queue are reused
+            QHash<QString, std::shared_ptr<QueueTrack>> oldTracksHash;
+            oldTracksHash.reserve(oldTracks.size());
+            for (const std::shared_ptr<QueueTrack>& track : oldTracks) {
+                oldTracksHash.insert(track->filePath, track);
+            }
 
-                db.transaction();
+            TracksReporter reporter(future, newTrackPaths.size());
 
-                QHash<QString, QString> mediaArtDirectoriesHash;
+            // Metadata of all chunks, the same file can be added several times
+            QHash<QString, TrackInfo> infos;
+            for (int chunkStart = 0, max = newTrackPaths.size(); chunkStart < max && !future.isCanceled();) {
+                const int chunkEnd = std::min(chunkStart + reporter.chunkSize(), max);
 
-                const bool useDirectoryMediaArt = Settings::instance()->useDirectoryMediaArt();
-
-                for (const QString& filePath : const_cast<const QStringList&>(newTrackPaths)) {
-                    bool found = false;
-                    for (const std::shared_ptr<QueueTrack>& track : oldTracks) {
-                        if (track->filePath == filePath) {
-                            tracks.append(track);
-                            found = true;
-                            break;
-                        }
+                QStringList newFilePaths;
+                for (int i = chunkStart; i < chunkEnd; ++i) {
+                    const QString& filePath = newTrackPaths.at(i);
+                    if (!oldTracksHash.contains(filePath) && !infos.contains(filePath)) {
+                        newFilePaths.append(filePath);
                     }
-                    if (found) {
+                }
+                newFilePaths.removeDuplicates();
+                infos.unite(getTracksInfo(newFilePaths));
+
+                for (int i = chunkStart; i < chunkEnd; ++i) {
+                    const QString& filePath = newTrackPaths.at(i);
+
+                    const auto oldTrack(oldTracksHash.constFind(filePath));
+                    if (oldTrack != oldTracksHash.constEnd()) {
+                        reporter.add(oldTrack.value());
                         continue;
                     }
 
-                    const QFileInfo fileInfo(filePath);
-                    if (!fileInfo.exists()) {
+                    const auto found(infos.constFind(filePath));
+                    if (found == infos.constEnd() || !found->exists) {
                         qWarning() << "file does not exist:" << filePath;
                         continue;
                     }
+                    reporter.add(makeTrack(filePath, found.value()));
+                }
 
-                    QString title;
-                    QStringList artists;
-                    QStringList albums;
-                    int duration;
-                    QString mediaArtFilePath;
-                    QByteArray mediaArtData;
-
-                    bool getTags = true;
-
-                    if (db.isOpen()) {
-                        QSqlQuery query(db);
-                        query.prepare(QStringLiteral("SELECT modificationTime, title, artist, album, duration, mediaArt FROM tracks WHERE filePath = ?"));
-                        query.lastError();
-                        query.addBindValue(filePath);
-                        if (query.exec()) {
-                            if (query.next()) {
-                                if (query.value(0).toLongLong() == fileInfo.lastModified().toMSecsSinceEpoch()) {
-                                    getTags = false;
-
-                                    title = query.value(1).toString();
-                                    duration = query.value(4).toInt();
-                                    mediaArtFilePath = query.value(5).toString();
-
-                                    query.previous();
-                                    while (query.next()) {
-                                        artists.append(query.value(2).toString());
-                                        albums.append(query.value(3).toString());
-                                    }
-                                    artists.removeDuplicates();
-                                    artists.removeAll(QString());
-                                    albums.removeDuplicates();
-                                    albums.removeAll(QString());
-                                }
-                            }
-                        } else {
-                            qWarning() << "failed to get track from database" << query.lastError();
-                        }
-                    }
+                chunkStart = chunkEnd;
+                reporter.report(chunkStart);
+            }
+        }, clearQueue, setAsCurrent);
+    }
 
-                    if (getTags) {
-                        const tagutils::Info info(tagutils::getTrackInfo(fileInfo, mimeDb.mimeTypeForFile(filePath, QMimeDatabase::MatchContent).name()));
-                        title = info.title;
-                        artists = info.artists;
-                        albums = info.albums;
-                        duration = info.duration;
-                        if (useDirectoryMediaArt) {
-                            mediaArtFilePath = LibraryUtils::findMediaArtForDirectory(mediaArtDirectoriesHash, fileInfo.path());
-                            if (mediaArtFilePath.isEmpty()) {
-                                mediaArtData = info.mediaArtData;
-                            }
-                        } else {
-                            if (info.mediaArtData.isEmpty()) {
-                                mediaArtFilePath = LibraryUtils::findMediaArtForDirectory(mediaArtDirectoriesHash, fileInfo.path());
-                            } else {
-                                mediaArtData = info.mediaArtData;
-                            }
-                        }
-                    }
+    void Queue::addLibraryTracks(const std::function<QVector<LibraryTrack>()>& getTracks, bool clearQueue, int setAsCurrent)
+    {
+        addQueueTracks([getTracks](const QVector<std::shared_ptr<QueueTrack>>&, QFutureInterface<std::shared_ptr<QueueTrack>>& future) {
+            const QVector<LibraryTrack> libraryTracks(getTracks());
+            QVector<std::shared_ptr<QueueTrack>> tracks;
+            tracks.reserve(libraryTracks.size());
+            for (const LibraryTrack& track : libraryTracks) {
+                tracks.append(makeTrack(track.filePath,
+                                        track.modificationTime,
+                                        track.title,
+                                        track.duration,
+                                        track.artists,
+                                        track.albums,
+                                        track.mediaArt,
+                                        QByteArray(),
+                                        -1,
+                                        0));
+            }
+            // Nothing to wait for, added at once
+            if (!tracks.isEmpty()) {
+                future.reportResults(tracks);
+            }
+        }, clearQueue, setAsCurrent);
+    }
 
-                    QString artist;
-                    if (artists.isEmpty()) {
-                        artist = qApp->translate("unplayer", "Unknown artist");
-                    } else {
-                        artist = artists.join(QLatin1String(", "));
-                    }
+    void Queue::restoreTracks(const std::function<QVector<std::shared_ptr<QueueTrack>>()>& getTracks, int setAsCurrent)
+    {
+        addQueueTracks([getTracks](const QVector<std::shared_ptr<QueueTrack>>&, QFutureInterface<std::shared_ptr<QueueTrack>>& future) {
+            // Added at once, so that restored shuffle order can be applied
+            const QVector<std::shared_ptr<QueueTrack>> tracks(getTracks());
+            if (!tracks.isEmpty()) {
+                future.reportResults(tracks);
+            }
+        }, true, setAsCurrent, [=]() {
+            revalidateTracks();
+        });
+    }
 
-                    QString album;
-                    if (albums.isEmpty()) {
-                        album = qApp->translate("unplayer", "Unknown artist");
-                    } else {
-                        album = albums.join(QLatin1String(", "));
-                    }
+    void Queue::addQueueTracks(const std::function<void(const QVector<std::shared_ptr<QueueTrack>>&, QFutureInterface<std::shared_ptr<QueueTrack>>&)>& createTracks,
+                               bool clearQueue,
+                               int setAsCurrent,
+                               const std::function<void()>& added)
+    {
+        if (mAddingTracks) {
+            return;
+        }
 
-                    tracks.append(std::make_shared<QueueTrack>(filePath,
-                                                               title,
-                                                               duration,
-                                                               artist,
-                                                               album,
-                                                               mediaArtFilePath,
-                                                               mediaArtData));
-                }
+        mAddingTracks = true;
+        emit addingTracksChanged();
+        mAddingTracksProgress = 0.0;
+        emit addingTracksProgressChanged();
 
-                db.commit();
-            }
-            QSqlDatabase::removeDatabase(dbConnectionName);
+        const QVector<std::shared_ptr<QueueTrack>> oldTracks(mTracks);
 
-            return tracks;
+        if (clearQueue) {
+            clear();
+        }
+
+        QFutureInterface<std::shared_ptr<QueueTrack>> futureInterface;
+        futureInterface.reportStarted();
+        mAddingTracksFuture = futureInterface.future();
+        QtConcurrent::run([createTracks, oldTracks, futureInterface]() mutable {
+            createTracks(oldTracks, futureInterface);
+            futureInterface.reportFinished();
         });
 
-        using FutureWatcher = QFutureWatcher<QList<std::shared_ptr<QueueTrack>>>;
+        using FutureWatcher = QFutureWatcher<std::shared_ptr<QueueTrack>>;
         auto watcher = new FutureWatcher(this);
-        QObject::connect(watcher, &FutureWatcher::finished, this, [=]() {
+
+        QObject::connect(watcher, &FutureWatcher::resultsReadyAt, this, [=](int beginIndex, int endIndex) {
+            if (watcher->isCanceled()) {
+                return;
+            }
+
             const int start = mTracks.size();
-            const auto tracks = watcher->result();
+            QVector<std::shared_ptr<QueueTrack>> tracks;
+            tracks.reserve(endIndex - beginIndex);
+            for (int i = beginIndex; i < endIndex; ++i) {
+                tracks.append(watcher->resultAt(i));
+            }
 
-            for (const auto& track : tracks) {
-                mTracks.append(track);
-                mNotPlayedTracks.append(track);
+            mTracks += tracks;
+            mMediaArt->addTracks(tracks);
+            mTrackIds.reserve(mTracks.size());
+            for (int i = start, max = mTracks.size(); i < max; ++i) {
+                const int id = mNextTrackId++;
+                mTrackIds.append(id);
+                if (mTrackPositionsValid) {
+                    mTrackPositions.insert(id, i);
+                }
+
+                // Inside-out Fisher-Yates, new track is swapped with random not played track
+                mShuffleOrder.append(id);
+                const int notPlayedCount = mShuffleOrder.size() - mShuffleIndex - 1;
+                std::swap(mShuffleOrder.last(), mShuffleOrder[mShuffleOrder.size() - 1 - qrand() % notPlayedCount]);
             }
             emit tracksAdded(start);
 
-            if (mCurrentIndex == -1 && !mTracks.isEmpty()) {
-                if (setAsCurrent < 0 || setAsCurrent >= mTracks.size()) {
-                    setCurrentIndex(0);
-                } else {
-                    setCurrentIndex(setAsCurrent);
+            // Playback starts as soon as track that should be current is here
+            if (mCurrentIndex == -1 && !mTracks.isEmpty() && setAsCurrent < mTracks.size()) {
+                setCurrentIndex(std::max(setAsCurrent, 0));
+                if (!applyRestoredShuffleOrder()) {
+                    resetNotPlayedTracks();
+                }
+                emit currentTrackChanged();
+            }
+        });
+
+        QObject::connect(watcher, &FutureWatcher::progressValueChanged, this, [=](int value) {
+            const int range = watcher->progressMaximum() - watcher->progressMinimum();
+            if (range > 0) {
+                mAddingTracksProgress = static_cast<double>(value - watcher->progressMinimum()) / range;
+                emit addingTracksProgressChanged();
+            }
+        });
+
+        QObject::connect(watcher, &FutureWatcher::finished, this, [=]() {
+            watcher->deleteLater();
+
+            // Current track was out of range
+            if (mCurrentIndex == -1 && !mTracks.isEmpty() && !watcher->isCanceled()) {
+                setCurrentIndex(0);
+                if (!applyRestoredShuffleOrder()) {
+                    resetNotPlayedTracks();
                 }
                 emit currentTrackChanged();
             }
+            mRestoredShuffleOrder.clear();
 
             mAddingTracks = false;
             emit addingTracksChanged();
+
+            if (added) {
+                added();
+            }
         });
-        watcher->setFuture(future);
+
+        watcher->setFuture(mAddingTracksFuture);
     }
 
     void Queue::removeTrack(int index)
     {
-        const std::shared_ptr<QueueTrack> currentTrack(mTracks.at(mCurrentIndex));
-        mNotPlayedTracks.removeOne(mTracks.takeAt(index));
+        const std::shared_ptr<QueueTrack> track(mTracks.at(index));
+        mTracks.remove(index);
+        mTrackIds.remove(index);
+        mTrackPositionsValid = false;
+        compactShuffleOrder();
+        mMediaArt->removeTracks({track}, mTracks);
 
-        emit trackRemoved(index);
+        emit tracksRemoved(index, index);
 
         if (index == mCurrentIndex) {
             if (mCurrentIndex >= mTracks.size()) {
@@ -409,36 +717,83 @@ namespace unplayer
                 emit currentIndexChanged();
             }
             emit currentTrackChanged();
-        } else {
-            setCurrentIndex(mTracks.indexOf(currentTrack));
+        } else if (index < mCurrentIndex) {
+            setCurrentIndex(mCurrentIndex - 1);
         }
     }
 
     void Queue::removeTracks(QVector<int> indexes)
     {
-        const std::shared_ptr<QueueTrack> currentTrack(mTracks.at(mCurrentIndex));
-
-        std::reverse(indexes.begin(), indexes.end());
-        for (int index : indexes) {
-            mNotPlayedTracks.removeOne(mTracks.takeAt(index));
+        if (indexes.isEmpty()) {
+            return;
         }
 
-        emit tracksRemoved(indexes);
+        std::sort(indexes.begin(), indexes.end());
+        indexes.erase(std::unique(indexes.begin(), indexes.end()), indexes.end());
+
+        const auto currentFound(std::lower_bound(indexes.cbegin(), indexes.cend(), mCurrentIndex));
+        const bool currentRemoved = (currentFound != indexes.cend() && *currentFound == mCurrentIndex);
+        const int removedBeforeCurrent = static_cast<int>(currentFound - indexes.cbegin());
+
+        // Remaining tracks are moved in one pass
+        QVector<std::shared_ptr<QueueTrack>> removedTracks;
+        removedTracks.reserve(indexes.size());
+        int removed = 0;
+        int newPosition = indexes.first();
+        for (int i = indexes.first(), max = mTracks.size(); i < max; ++i) {
+            if (removed < indexes.size() && indexes.at(removed) == i) {
+                removedTracks.append(mTracks.at(i));
+                ++removed;
+            } else {
+                mTracks[newPosition] = std::move(mTracks[i]);
+                mTrackIds[newPosition] = mTrackIds.at(i);
+                ++newPosition;
+            }
+        }
+        mTracks.resize(newPosition);
+        mTrackIds.resize(newPosition);
+        mTrackPositionsValid = false;
+        compactShuffleOrder();
+        mMediaArt->removeTracks(removedTracks, mTracks);
+
+        // Removing ranges from the last one doesn't change indexes of the rest
+        for (int last = indexes.size() - 1; last >= 0;) {
+            int first = last;
+            while (first > 0 && indexes.at(first - 1) == indexes.at(first) - 1) {
+                --first;
+            }
+            emit tracksRemoved(indexes.at(first), indexes.at(last));
+            last = first - 1;
+        }
 
-        if (indexes.contains(mCurrentIndex)) {
-            if (mCurrentIndex >= mTracks.size()) {
-                setCurrentIndex(mTracks.size() - 1);
+        if (currentRemoved) {
+            // Next track that was not removed becomes current
+            const int index = std::min(mCurrentIndex - removedBeforeCurrent, mTracks.size() - 1);
+            if (index == mCurrentIndex) {
+                emit currentIndexChanged();
+            } else {
+                setCurrentIndex(index);
             }
             emit currentTrackChanged();
         } else {
-            setCurrentIndex(mTracks.indexOf(currentTrack));
+            setCurrentIndex(mCurrentIndex - removedBeforeCurrent);
         }
     }
 
     void Queue::clear()
     {
+        // Tracks that are still being resolved are not added
+        if (mAddingTracksFuture.isRunning()) {
+            mAddingTracksFuture.cancel();
+        }
+
         mTracks.clear();
-        mNotPlayedTracks.clear();
+        mTrackIds.clear();
+        mTrackPositions.clear();
+        mTrackPositionsValid = true;
+        mShuffleOrder.clear();
+        mShuffleIndex = -1;
+        mMediaArt->clear();
         emit cleared();
         setCurrentIndex(-1);
         emit currentTrackChanged();
@@ -447,11 +802,16 @@ namespace unplayer
     void Queue::next()
     {
         if (mShuffle) {
-            if (mNotPlayedTracks.length() == 1) {
+            int position = stepShuffle(true);
+            if (position == -1) {
+                // All tracks were played, shuffle them again
                 resetNotPlayedTracks();
+                position = stepShuffle(true);
+                if (position == -1) {
+                    position = mCurrentIndex;
+                }
             }
-            mNotPlayedTracks.removeOne(mTracks.at(mCurrentIndex));
-            setCurrentIndex(mTracks.indexOf(mNotPlayedTracks.at(qrand() % mNotPlayedTracks.size())));
+            setCurrentIndex(position);
         } else {
             if (mCurrentIndex == (mTracks.size() - 1)) {
                 setCurrentIndex(0);
@@ -471,17 +831,19 @@ namespace unplayer
         }
 
         if (mShuffle) {
-            const std::shared_ptr<QueueTrack>& track = mTracks.at(mCurrentIndex);
-            mNotPlayedTracks.removeOne(track);
-            if (mNotPlayedTracks.size() == 0) {
+            int position = stepShuffle(true);
+            if (position == -1) {
                 if (mRepeatMode == RepeatAll) {
                     resetNotPlayedTracks();
-                    mNotPlayedTracks.removeOne(track);
+                    position = stepShuffle(true);
+                    if (position == -1) {
+                        position = mCurrentIndex;
+                    }
                 } else {
                     return;
                 }
             }
-            setCurrentIndex(mTracks.indexOf(mNotPlayedTracks.at(qrand() % mNotPlayedTracks.size())));
+            setCurrentIndex(position);
         } else {
             if (mCurrentIndex == (mTracks.size() - 1)) {
                 if (mRepeatMode == RepeatAll) {
@@ -500,10 +862,13 @@ namespace unplayer
     void Queue::previous()
     {
         if (mShuffle) {
-            return;
-        }
-
-        if (mCurrentIndex == 0) {
+            // Go back through shuffle history
+            const int position = stepShuffle(false);
+            if (position == -1) {
+                return;
+            }
+            setCurrentIndex(position);
+        } else if (mCurrentIndex == 0) {
             setCurrentIndex(mTracks.size() - 1);
         } else {
             setCurrentIndex(mCurrentIndex - 1);
@@ -522,7 +887,303 @@ namespace unplayer
 
     void Queue::resetNotPlayedTracks()
     {
-        mNotPlayedTracks = mTracks;
+        mShuffleOrder = mTrackIds;
+        for (int i = mShuffleOrder.size() - 1; i > 0; --i) {
+            std::swap(mShuffleOrder[i], mShuffleOrder[qrand() % (i + 1)]);
+        }
+
+        if (mCurrentIndex >= 0 && mCurrentIndex < mTracks.size()) {
+            const auto current(std::find(mShuffleOrder.begin(), mShuffleOrder.end(), mTrackIds.at(mCurrentIndex)));
+            std::swap(*current, mShuffleOrder.first());
+            mShuffleIndex = 0;
+        } else {
+            mShuffleIndex = -1;
+        }
+    }
+
+    const std::shared_ptr<QueueMediaArt>& Queue::mediaArt() const
+    {
+        return mMediaArt;
+    }
+
+    QVector<int> Queue::shuffleOrder(int& index) const
+    {
+        QVector<int> order;
+        order.reserve(mTracks.size());
+        index = -1;
+        for (int i = 0, max = mShuffleOrder.size(); i < max; ++i) {
+            const int position = trackPosition(mShuffleOrder.at(i));
+            if (position != -1) {
+                order.append(position);
+                if (i <= mShuffleIndex) {
+                    index = order.size() - 1;
+                }
+            }
+        }
+        return order;
+    }
+
+    void Queue::restoreShuffleOrder(const QVector<int>& order, int index)
+    {
+        mRestoredShuffleOrder = order;
+        mRestoredShuffleIndex = index;
+    }
+
+    void Queue::updateMediaArt()
+    {
+        if (mUpdatingMediaArt) {
+            mMediaArtUpdatePending = true;
+            return;
+        }
+
+        if (mTracks.isEmpty()) {
+            return;
+        }
+
+        mUpdatingMediaArt = true;
+
+        // Tracks are modified only in GUI thread, copy what worker needs
+        QStringList filePaths;
+        QStringList mediaArt;
+        filePaths.reserve(mTracks.size());
+        mediaArt.reserve(mTracks.size());
+        for (const std::shared_ptr<QueueTrack>& track : mTracks) {
+            filePaths.append(track->filePath);
+            mediaArt.append(track->mediaArtFilePath);
+        }
+
+        using MediaArtChanges = QVector<std::pair<std::shared_ptr<QueueTrack>, QString>>;
+
+        const QVector<std::shared_ptr<QueueTrack>> tracks(mTracks);
+        auto future = QtConcurrent::run([tracks, filePaths, mediaArt]() {
+            QStringList uniqueFilePaths(filePaths);
+            uniqueFilePaths.removeDuplicates();
+            const QHash<QString, TrackInfo> libraryTracks(getLibraryTracks(uniqueFilePaths));
+
+            MediaArtChanges changes;
+            for (int i = 0, max = tracks.size(); i < max; ++i) {
+                const auto found(libraryTracks.constFind(filePaths.at(i)));
+                if (found != libraryTracks.constEnd() && found->mediaArtFilePath != mediaArt.at(i)) {
+                    changes.push_back({tracks.at(i), found->mediaArtFilePath});
+                }
+            }
+            return changes;
+        });
+
+        using FutureWatcher = QFutureWatcher<MediaArtChanges>;
+        auto watcher = new FutureWatcher(this);
+        QObject::connect(watcher, &FutureWatcher::finished, this, [=]() {
+            const MediaArtChanges changes(watcher->result());
+            watcher->deleteLater();
+
+            if (!changes.isEmpty()) {
+                QSet<const QueueTrack*> changed;
+                changed.reserve(changes.size());
+                for (const auto& change : changes) {
+                    change.first->mediaArtFilePath = change.second;
+                    changed.insert(change.first.get());
+                }
+
+                // Tracks could be moved or removed meanwhile
+                QVector<int> indexes;
+                bool currentChanged = false;
+                for (int i = 0, max = mTracks.size(); i < max; ++i) {
+                    if (changed.contains(mTracks.at(i).get())) {
+                        indexes.append(i);
+                        if (i == mCurrentIndex) {
+                            currentChanged = true;
+                        }
+                    }
+                }
+                if (!indexes.isEmpty()) {
+                    emit tracksUpdated(indexes);
+                }
+                if (currentChanged) {
+                    emit mediaArtChanged();
+                }
+            }
+
+            mUpdatingMediaArt = false;
+            if (mMediaArtUpdatePending) {
+                mMediaArtUpdatePending = false;
+                updateMediaArt();
+            }
+        });
+        watcher->setFuture(future);
+    }
+
+    void Queue::revalidateTracks()
+    {
+        if (mTracks.isEmpty()) {
+            return;
+        }
+
+        // Tracks are modified only in GUI thread, copy what worker needs
+        QStringList filePaths;
+        QVector<long long> modificationTimes;
+        filePaths.reserve(mTracks.size());
+        modificationTimes.reserve(mTracks.size());
+        for (const std::shared_ptr<QueueTrack>& track : mTracks) {
+            filePaths.append(track->filePath);
+            modificationTimes.append(track->modificationTime);
+        }
+
+        using TrackChanges = QVector<std::pair<std::shared_ptr<QueueTrack>, std::shared_ptr<QueueTrack>>>;
+
+        const QVector<std::shared_ptr<QueueTrack>> tracks(mTracks);
+        auto future = QtConcurrent::run([tracks, filePaths, modificationTimes]() {
+            // Missing files are left as they are
+            QHash<QString, long long> fileModificationTimes;
+            QVector<int> changed;
+            QStringList changedFilePaths;
+            for (int i = 0, max = filePaths.size(); i < max; ++i) {
+                const QString& filePath = filePaths.at(i);
+                auto found(fileModificationTimes.find(filePath));
+                if (found == fileModificationTimes.end()) {
+                    const QFileInfo fileInfo(filePath);
+                    found = fileModificationTimes.insert(filePath, fileInfo.exists() ? fileInfo.lastModified().toMSecsSinceEpoch() : 0);
+                }
+                if (found.value() != 0 && found.value() != modificationTimes.at(i)) {
+                    changed.append(i);
+                    changedFilePaths.append(filePath);
+                }
+            }
+
+            TrackChanges changes;
+            if (changed.isEmpty()) {
+                return changes;
+            }
+
+            changedFilePaths.removeDuplicates();
+            const QHash<QString, TrackInfo> infos(getTracksInfo(changedFilePaths));
+            for (int i : changed) {
+                const auto found(infos.constFind(filePaths.at(i)));
+                if (found != infos.constEnd() && found->exists) {
+                    changes.push_back({tracks.at(i), makeTrack(filePaths.at(i), found.value())});
+                }
+            }
+            return changes;
+        });
+
+        using FutureWatcher = QFutureWatcher<TrackChanges>;
+        auto watcher = new FutureWatcher(this);
+        QObject::connect(watcher, &FutureWatcher::finished, this, [=]() {
+            const TrackChanges changes(watcher->result());
+            watcher->deleteLater();
+
+            if (changes.isEmpty()) {
+                return;
+            }
+
+            // Track objects are updated in place, they could be moved or removed meanwhile
+            QVector<std::shared_ptr<QueueTrack>> updatedTracks;
+            QSet<const QueueTrack*> updated;
+            updatedTracks.reserve(changes.size());
+            updated.reserve(changes.size());
+            for (const auto& change : changes) {
+                *change.first = *change.second;
+                updatedTracks.append(change.first);
+                updated.insert(change.first.get());
+            }
+            mMediaArt->addTracks(updatedTracks);
+
+            QVector<int> indexes;
+            bool currentChanged = false;
+            for (int i = 0, max = mTracks.size(); i < max; ++i) {
+                if (updated.contains(mTracks.at(i).get())) {
+                    indexes.append(i);
+                    if (i == mCurrentIndex) {
+                        currentChanged = true;
+                    }
+                }
+            }
+            if (!indexes.isEmpty()) {
+                emit tracksUpdated(indexes);
+            }
+            if (currentChanged) {
+                emit currentMetadataChanged();
+                emit mediaArtChanged();
+            }
+        });
+        watcher->setFuture(future);
+    }
+
+    int Queue::trackPosition(int id) const
+    {
+        if (!mTrackPositionsValid) {
+            mTrackPositions.clear();
+            mTrackPositions.reserve(mTrackIds.size());
+            for (int i = 0, max = mTrackIds.size(); i < max; ++i) {
+                mTrackPositions.insert(mTrackIds.at(i), i);
+            }
+            mTrackPositionsValid = true;
+        }
+        return mTrackPositions.value(id, -1);
+    }
+
+    int Queue::stepShuffle(bool forward)
+    {
+        int index = mShuffleIndex;
+        while (true) {
+            index += forward ? 1 : -1;
+            if (index < 0 || index >= mShuffleOrder.size()) {
+                return -1;
+            }
+            const int position = trackPosition(mShuffleOrder.at(index));
+            if (position != -1) {
+                mShuffleIndex = index;
+                return position;
+            }
+        }
+    }
+
+    void Queue::compactShuffleOrder()
+    {
+        if (mShuffleOrder.size() < 2 * mTracks.size()) {
+            return;
+        }
+
+        int newIndex = -1;
+        int newSize = 0;
+        for (int i = 0, max = mShuffleOrder.size(); i < max; ++i) {
+            const int id = mShuffleOrder.at(i);
+            if (trackPosition(id) != -1) {
+                mShuffleOrder[newSize] = id;
+                if (i <= mShuffleIndex) {
+                    newIndex = newSize;
+                }
+                ++newSize;
+            }
+        }
+        mShuffleOrder.resize(newSize);
+        mShuffleIndex = newIndex;
+    }
+
+    bool Queue::applyRestoredShuffleOrder()
+    {
+        // Some tracks could be missing when queue is restored
+        const int count = mTracks.size();
+        if (mRestoredShuffleOrder.size() != count ||
+                mRestoredShuffleIndex < 0 ||
+                mRestoredShuffleIndex >= count ||
+                mRestoredShuffleOrder.at(mRestoredShuffleIndex) != mCurrentIndex) {
+            return false;
+        }
+
+        QVector<bool> found(count, false);
+        QVector<int> order;
+        order.reserve(count);
+        for (int position : mRestoredShuffleOrder) {
+            if (position < 0 || position >= count || found.at(position)) {
+                return false;
+            }
+            found[position] = true;
+            order.append(mTrackIds.at(position));
+        }
+
+        mShuffleOrder = order;
+        mShuffleIndex = mRestoredShuffleIndex;
+        return true;
     }
 
     void Queue::reset()
@@ -532,33 +1193,161 @@ namespace unplayer
         emit currentTrackChanged();
     }
 
-    const QString QueueImageProvider::providerId(QLatin1String("queue"));
-
-    QueueImageProvider::QueueImageProvider(const Queue* queue)
-        : QQuickImageProvider(QQuickImageProvider::Pixmap),
-          mQueue(queue)
+    QueueMediaArt::QueueMediaArt(int cacheSize)
+        : mImages(cacheSize)
     {
 
     }
 
-    QPixmap QueueImageProvider::requestPixmap(const QString& id, QSize*, const QSize& requestedSize)
+    void QueueMediaArt::addTracks(const QVector<std::shared_ptr<QueueTrack>>& tracks)
     {
-        for (const auto& track : mQueue->tracks()) {
-            if (track->filePath == id) {
-                const QPixmap& pixmap = track->mediaArtPixmap;
-                if (requestedSize.isValid()) {
-                    QSize newSize(requestedSize);
-                    if (newSize.width() == 0) {
-                        newSize.setWidth(pixmap.width());
-                    }
-                    if (newSize.height() == 0) {
-                        newSize.setHeight(pixmap.height());
-                    }
-                    return pixmap.scaled(newSize, Qt::KeepAspectRatio);
+        const QMutexLocker locker(&mMutex);
+        for (const std::shared_ptr<QueueTrack>& track : tracks) {
+            if (!track->mediaArtKey.isEmpty() && !mLocations.contains(track->mediaArtKey)) {
+                mLocations.insert(track->mediaArtKey, {track->filePath, track->mediaArtOffset, track->mediaArtLength});
+            }
+        }
+    }
+
+    void QueueMediaArt::removeTracks(const QVector<std::shared_ptr<QueueTrack>>& removedTracks,
+                                     const QVector<std::shared_ptr<QueueTrack>>& remainingTracks)
+    {
+        QSet<QByteArray> keys;
+        for (const std::shared_ptr<QueueTrack>& track : removedTracks) {
+            if (!track->mediaArtKey.isEmpty()) {
+                keys.insert(track->mediaArtKey);
+            }
+        }
+        for (const std::shared_ptr<QueueTrack>& track : remainingTracks) {
+            if (keys.isEmpty()) {
+                return;
+            }
+            keys.remove(track->mediaArtKey);
+        }
+        if (keys.isEmpty()) {
+            return;
+        }
+
+        const QMutexLocker locker(&mMutex);
+        for (const QByteArray& key : keys) {
+            mLocations.remove(key);
+        }
+        // Scaled images are cached with the size appended to the key
+        const QList<QByteArray> cacheKeys(mImages.keys());
+        for (const QByteArray& cacheKey : cacheKeys) {
+            for (const QByteArray& key : keys) {
+                if (cacheKey.startsWith(key)) {
+                    mImages.remove(cacheKey);
+                    break;
                 }
-                return pixmap;
             }
         }
-        return QPixmap();
+    }
+
+    void QueueMediaArt::clear()
+    {
+        const QMutexLocker locker(&mMutex);
+        mLocations.clear();
+        mImages.clear();
+    }
+
+    QImage QueueMediaArt::image(const QByteArray& key, const QSize& requestedSize)
+    {
+        QSize size;
+        if (requestedSize.isValid()) {
+            size = requestedSize;
+        }
+        const QByteArray cacheKey(size.isValid() ? key + '@' + QByteArray::number(size.width()) + 'x' + QByteArray::number(size.height())
+                                                 : key);
+
+        Location location;
+        QImage image;
+        {
+            const QMutexLocker locker(&mMutex);
+            if (const QImage* cached = mImages.object(cacheKey)) {
+                return *cached;
+            }
+            const auto found(mLocations.constFind(key));
+            if (found == mLocations.constEnd()) {
+                return QImage();
+            }
+            location = found.value();
+            if (const QImage* cached = mImages.object(key)) {
+                image = *cached;
+            }
+        }
+
+        // Decoded and scaled without lock, so that other images can be loaded meanwhile
+        if (image.isNull()) {
+            if (!image.loadFromData(tagutils::getMediaArtData(location.filePath, location.offset, location.length))) {
+                qWarning() << "failed to load embedded media art from file:" << location.filePath;
+                return QImage();
+            }
+            const QMutexLocker locker(&mMutex);
+            mImages.insert(key, new QImage(image), image.byteCount());
+        }
+
+        if (!size.isValid()) {
+            return image;
+        }
+
+        if (size.width() == 0) {
+            size.setWidth(image.width());
+        }
+        if (size.height() == 0) {
+            size.setHeight(image.height());
+        }
+        const QImage scaled(image.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation));
+
+        const QMutexLocker locker(&mMutex);
+        mImages.insert(cacheKey, new QImage(scaled), scaled.byteCount());
+        return scaled;
+    }
+
+    namespace
+    {
+        class QueueImageResponse : public QQuickImageResponse, public QRunnable
+        {
+        public:
+            QueueImageResponse(const std::shared_ptr<QueueMediaArt>& mediaArt, const QByteArray& key, const QSize& requestedSize)
+                : mMediaArt(mediaArt),
+                  mKey(key),
+                  mRequestedSize(requestedSize)
+            {
+                setAutoDelete(false);
+            }
+
+            QQuickTextureFactory* textureFactory() const override
+            {
+                return QQuickTextureFactory::textureFactoryForImage(mImage);
+            }
+
+            void run() override
+            {
+                mImage = mMediaArt->image(mKey, mRequestedSize);
+                emit finished();
+            }
+
+        private:
+            std::shared_ptr<QueueMediaArt> mMediaArt;
+            QByteArray mKey;
+            QSize mRequestedSize;
+            QImage mImage;
+        };
+    }
+
+    const QString QueueImageProvider::providerId(QLatin1String("queue"));
+
+    QueueImageProvider::QueueImageProvider(const Queue* queue)
+        : mMediaArt(queue->mediaArt())
+    {
+
+    }
+
+    QQuickImageResponse* QueueImageProvider::requestImageResponse(const QString& id, const QSize& requestedSize)
+    {
+        auto response = new QueueImageResponse(mMediaArt, QByteArray::fromHex(id.toLatin1()), requestedSize);
+        QThreadPool::globalInstance()->start(response);
+        return response;
     }
 }
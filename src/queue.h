@@ -19,33 +19,81 @@
 #ifndef UNPLAYER_QUEUE_H
 #define UNPLAYER_QUEUE_H
 
+#include <functional>
 #include <memory>
 
+#include <QCache>
+#include <QFuture>
+#include <QFutureInterface>
+#include <QHash>
+#include <QMutex>
 #include <QObject>
 #include <QQuickImageProvider>
 #include <QStringList>
 #include <QUrl>
+#include <QVector>
 
 namespace unplayer
 {
+    struct LibraryTrack;
+
     struct QueueTrack
     {
         explicit QueueTrack(const QString& filePath,
+                            long long modificationTime,
                             const QString& title,
                             int duration,
                             const QString& artist,
                             const QString& album,
                             const QString& mediaArtFilePath,
-                            const QByteArray& mediaArtData);
+                            const QByteArray& mediaArtKey,
+                            long long mediaArtOffset,
+                            long long mediaArtLength);
 
         QString filePath;
+        // Modification time of file when metadata was read, 0 if it is not known.
+        // Metadata of restored queue is read again if file was changed since then
+        long long modificationTime;
         QString title;
         int duration;
         QString artist;
         QString album;
 
         QString mediaArtFilePath;
-        QPixmap mediaArtPixmap;
+
+        // Embedded media art is decoded only when it is needed. Key is a hash
+        // of the picture, so that tracks with the same picture share it
+        QByteArray mediaArtKey;
+        long long mediaArtOffset;
+        long long mediaArtLength;
+    };
+
+    // Embedded media art of queue tracks. Pictures are decoded when they are requested,
+    // and kept with their scaled versions in a cache limited by size. Thread-safe
+    class QueueMediaArt
+    {
+    public:
+        explicit QueueMediaArt(int cacheSize);
+
+        void addTracks(const QVector<std::shared_ptr<QueueTrack>>& tracks);
+        // Media art of removed tracks is forgotten if remaining tracks don't use it
+        void removeTracks(const QVector<std::shared_ptr<QueueTrack>>& removedTracks,
+                          const QVector<std::shared_ptr<QueueTrack>>& remainingTracks);
+        void clear();
+
+        QImage image(const QByteArray& key, const QSize& requestedSize);
+
+    private:
+        struct Location
+        {
+            QString filePath;
+            long long offset;
+            long long length;
+        };
+
+        QMutex mMutex;
+        QHash<QByteArray, Location> mLocations;
+        QCache<QByteArray, QImage> mImages;
     };
 
     class Queue : public QObject
@@ -57,15 +105,17 @@ namespace unplayer
         Q_PROPERTY(int currentIndex READ currentIndex WRITE setCurrentIndex NOTIFY currentIndexChanged)
 
         Q_PROPERTY(QString currentFilePath READ currentFilePath NOTIFY currentTrackChanged)
-        Q_PROPERTY(QString currentTitle READ currentTitle NOTIFY currentTrackChanged)
-        Q_PROPERTY(QString currentArtist READ currentArtist NOTIFY currentTrackChanged)
-        Q_PROPERTY(QString currentAlbum READ currentAlbum NOTIFY currentTrackChanged)
+        Q_PROPERTY(QString currentTitle READ currentTitle NOTIFY currentMetadataChanged)
+        Q_PROPERTY(QString currentArtist READ currentArtist NOTIFY currentMetadataChanged)
+        Q_PROPERTY(QString currentAlbum READ currentAlbum NOTIFY currentMetadataChanged)
         Q_PROPERTY(QUrl currentMediaArt READ currentMediaArt NOTIFY mediaArtChanged)
 
         Q_PROPERTY(bool shuffle READ isShuffle WRITE setShuffle NOTIFY shuffleChanged)
         Q_PROPERTY(RepeatMode repeatMode READ repeatMode NOTIFY repeatModeChanged)
 
         Q_PROPERTY(bool addingTracks READ isAddingTracks NOTIFY addingTracksChanged)
+        // Fraction of tracks that were resolved, from 0 to 1
+        Q_PROPERTY(double addingTracksProgress READ addingTracksProgress NOTIFY addingTracksProgressChanged)
     public:
         enum RepeatMode
         {
@@ -76,7 +126,8 @@ namespace unplayer
 
         explicit Queue(QObject* parent);
 
-        const QList<std::shared_ptr<QueueTrack>>& tracks() const;
+        const QVector<std::shared_ptr<QueueTrack>>& tracks() const;
+        const QVector<int>& trackIds() const;
 
         int currentIndex() const;
         void setCurrentIndex(int index);
@@ -95,9 +146,17 @@ namespace unplayer
         void setRepeatMode(int mode);
 
         bool isAddingTracks() const;
+        double addingTracksProgress() const;
 
         Q_INVOKABLE void addTrack(const QString& track);
         Q_INVOKABLE void addTracks(const QStringList& trackPaths, bool clearQueue = false, int setAsCurrent = -1);
+        // Track paths are resolved by getTrackPaths in a worker thread.
+        // Tracks are added in chunks while their metadata is read
+        void addTracks(const std::function<QStringList()>& getTrackPaths, bool clearQueue = false, int setAsCurrent = -1);
+        // Library tracks already have their metadata, nothing is looked up again
+        void addLibraryTracks(const std::function<QVector<LibraryTrack>()>& getTracks, bool clearQueue = false, int setAsCurrent = -1);
+        // Saved tracks already have their metadata, it is checked later in a worker thread
+        void restoreTracks(const std::function<QVector<std::shared_ptr<QueueTrack>>()>& getTracks, int setAsCurrent);
         Q_INVOKABLE void removeTrack(int index);
         Q_INVOKABLE void removeTracks(QVector<int> indexes);
         Q_INVOKABLE void clear();
@@ -107,45 +166,101 @@ namespace unplayer
         Q_INVOKABLE void previous();
 
         Q_INVOKABLE void setCurrentToFirstIfNeeded();
+        // Shuffles tracks again, current track becomes the first played one
         Q_INVOKABLE void resetNotPlayedTracks();
 
+        const std::shared_ptr<QueueMediaArt>& mediaArt() const;
+
+        // Shuffle order as positions of tracks, index is position of current track in it
+        QVector<int> shuffleOrder(int& index) const;
+        // Applied when tracks are added to empty queue, if it is still valid for them
+        void restoreShuffleOrder(const QVector<int>& order, int index);
+
     private:
         void reset();
 
+        // Media art of tracks is read from library in a worker thread
+        void updateMediaArt();
+        // Metadata of tracks which files were changed is read again in a worker thread
+        void revalidateTracks();
+
+        // Position of track with given id, or -1
+        int trackPosition(int id) const;
+
+        // Moves to next or previous track in shuffle order that is still in queue, returns its position or -1
+        int stepShuffle(bool forward);
+        void compactShuffleOrder();
+        bool applyRestoredShuffleOrder();
+
+        // Tracks are created by createTracks in a worker thread, it is passed tracks that were in queue.
+        // Tracks that it reports to future are added while it is running. added is called when it is finished
+        void addQueueTracks(const std::function<void(const QVector<std::shared_ptr<QueueTrack>>&, QFutureInterface<std::shared_ptr<QueueTrack>>&)>& createTracks,
+                            bool clearQueue,
+                            int setAsCurrent,
+                            const std::function<void()>& added = nullptr);
+
     private:
-        QList<std::shared_ptr<QueueTrack>> mTracks;
-        QList<std::shared_ptr<QueueTrack>> mNotPlayedTracks;
+        QVector<std::shared_ptr<QueueTrack>> mTracks;
+        // Ids that identify tracks while they are in queue, in the same order as tracks.
+        // The same track can be added several times, each time with a new id
+        QVector<int> mTrackIds;
+        int mNextTrackId;
+        // Rebuilt when it is needed after tracks were removed
+        mutable QHash<int, int> mTrackPositions;
+        mutable bool mTrackPositionsValid;
+
+        // Fisher-Yates permutation of track ids. Tracks up to mShuffleIndex were played, the rest were not.
+        // Ids of removed tracks are skipped, and dropped when they are half of the vector
+        QVector<int> mShuffleOrder;
+        int mShuffleIndex;
+
+        QVector<int> mRestoredShuffleOrder;
+        int mRestoredShuffleIndex;
 
         int mCurrentIndex;
         bool mShuffle;
         RepeatMode mRepeatMode;
 
         bool mAddingTracks;
+        double mAddingTracksProgress;
+        QFuture<std::shared_ptr<QueueTrack>> mAddingTracksFuture;
+
+        bool mUpdatingMediaArt;
+        bool mMediaArtUpdatePending;
+
+        std::shared_ptr<QueueMediaArt> mMediaArt;
     signals:
         void currentTrackChanged();
 
+        // Also emitted when metadata of current track is read again
+        void currentMetadataChanged();
         void mediaArtChanged();
 
         void currentIndexChanged();
         void shuffleChanged();
         void repeatModeChanged();
 
+        // Tracks from start to the end of queue
         void tracksAdded(int start);
-        void trackRemoved(int index);
-        void tracksRemoved(const QVector<int>& indexes);
+        // Emitted for each contiguous range, from the last one
+        void tracksRemoved(int first, int last);
+        // Metadata of tracks was changed
+        void tracksUpdated(const QVector<int>& indexes);
         void cleared();
 
         void addingTracksChanged();
+        void addingTracksProgressChanged();
     };
 
-    class QueueImageProvider : public QQuickImageProvider
+    // Id is media art key of track, images are loaded in global thread pool
+    class QueueImageProvider : public QQuickAsyncImageProvider
     {
     public:
         static const QString providerId;
         explicit QueueImageProvider(const Queue* queue);
-        QPixmap requestPixmap(const QString& id, QSize*, const QSize& requestedSize) override;
+        QQuickImageResponse* requestImageResponse(const QString& id, const QSize& requestedSize) override;
     private:
-        const Queue* mQueue;
+        std::shared_ptr<QueueMediaArt> mMediaArt;
     };
 }
 
@@ -64,26 +64,24 @@ namespace unplayer
         mTracks = mQueue->tracks();
 
         QObject::connect(mQueue, &Queue::tracksAdded, this, [=](int start) {
-            const QList<std::shared_ptr<QueueTrack>>& tracks = mQueue->tracks();
-            for (int i = start, max = tracks.size(); i < max; i++) {
-                beginInsertRows(QModelIndex(), i, i);
-                mTracks.append(tracks.at(i));
-                endInsertRows();
+            const QVector<std::shared_ptr<QueueTrack>>& tracks = mQueue->tracks();
+            if (start >= tracks.size()) {
+                return;
             }
+            beginInsertRows(QModelIndex(), start, tracks.size() - 1);
+            mTracks += tracks.mid(start);
+            endInsertRows();
         });
 
-        QObject::connect(mQueue, &Queue::trackRemoved, this, [=](int index) {
-            beginRemoveRows(QModelIndex(), index, index);
-            mTracks.removeAt(index);
+        QObject::connect(mQueue, &Queue::tracksRemoved, this, [=](int first, int last) {
+            beginRemoveRows(QModelIndex(), first, last);
+            mTracks.remove(first, last - first + 1);
             endRemoveRows();
         });
 
-        QObject::connect(mQueue, &Queue::tracksRemoved, this, [=](const QVector<int>& indexes) {
-            for (int index : indexes) {
-                beginRemoveRows(QModelIndex(), index, index);
-                mTracks.removeAt(index);
-                endRemoveRows();
-            }
+        QObject::connect(mQueue, &Queue::tracksUpdated, this, [=](const QVector<int>& indexes) {
+            // Indexes are sorted
+            emit dataChanged(index(indexes.first()), index(indexes.last()));
         });
 
         QObject::connect(mQueue, &Queue::cleared, this, [=]() {
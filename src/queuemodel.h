@@ -56,7 +56,7 @@ namespace unplayer
 
     private:
         Queue* mQueue = nullptr;
-        QList<std::shared_ptr<QueueTrack>> mTracks;
+        QVector<std::shared_ptr<QueueTrack>> mTracks;
     };
 }
 
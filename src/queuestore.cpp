@@ -0,0 +1,350 @@
+/*
+ * Unplayer
+ * Copyright (C) 2015-2017 Alexey Rochev <equeim@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "queuestore.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <QDebug>
+#include <QDir>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStandardPaths>
+#include <QThreadStorage>
+#include <QtConcurrentRun>
+
+#include "queue.h"
+
+namespace unplayer
+{
+    namespace
+    {
+        const QLatin1String currentIndexKey("currentIndex");
+        const QLatin1String positionKey("position");
+        const QLatin1String shuffleOrderKey("shuffleOrder");
+        const QLatin1String shuffleIndexKey("shuffleIndex");
+
+        class Connection
+        {
+        public:
+            Connection()
+                : name(QString::fromLatin1("unplayer_queue_%1").arg(reinterpret_cast<quintptr>(this)))
+            {
+                const QString dataDir(QStandardPaths::writableLocation(QStandardPaths::DataLocation));
+                if (!QDir().mkpath(dataDir)) {
+                    qWarning() << "failed to create data directory";
+                    return;
+                }
+
+                auto db = QSqlDatabase::addDatabase(QLatin1String("QSQLITE"), name);
+                db.setDatabaseName(QString::fromLatin1("%1/queue.sqlite").arg(dataDir));
+                if (!db.open()) {
+                    qWarning() << "failed to open queue database" << db.lastError();
+                    return;
+                }
+
+                // auto_vacuum must be set before tables are created.
+                // WAL with synchronous = NORMAL keeps database consistent after a crash
+                static const QLatin1String statements[] = {QLatin1String("PRAGMA auto_vacuum = INCREMENTAL"),
+                                                           QLatin1String("PRAGMA journal_mode = WAL"),
+                                                           QLatin1String("PRAGMA synchronous = NORMAL"),
+                                                           QLatin1String("CREATE TABLE IF NOT EXISTS tracks ("
+                                                                         "    id INTEGER PRIMARY KEY,"
+                                                                         "    filePath TEXT NOT NULL,"
+                                                                         "    modificationTime INTEGER,"
+                                                                         "    title TEXT,"
+                                                                         "    artist TEXT,"
+                                                                         "    album TEXT,"
+                                                                         "    duration INTEGER,"
+                                                                         "    mediaArtFilePath TEXT,"
+                                                                         "    mediaArtKey BLOB,"
+                                                                         "    mediaArtOffset INTEGER,"
+                                                                         "    mediaArtLength INTEGER"
+                                                                         ")"),
+                                                           QLatin1String("CREATE TABLE IF NOT EXISTS state (key TEXT PRIMARY KEY, value)")};
+                QSqlQuery query(db);
+                for (const QLatin1String& statement : statements) {
+                    if (!query.exec(statement)) {
+                        qWarning() << "failed to execute" << statement << query.lastError();
+                    }
+                }
+            }
+
+            ~Connection()
+            {
+                QSqlDatabase::removeDatabase(name);
+            }
+
+            const QString name;
+        };
+
+        // Only used in store thread
+        QThreadStorage<Connection*> connections;
+
+        QSqlDatabase database()
+        {
+            if (!connections.hasLocalData()) {
+                connections.setLocalData(new Connection());
+            }
+            return QSqlDatabase::database(connections.localData()->name, false);
+        }
+
+        void setState(const QLatin1String& key, const QVariant& value)
+        {
+            QSqlQuery query(database());
+            query.prepare(QStringLiteral("INSERT OR REPLACE INTO state (key, value) VALUES (?, ?)"));
+            query.addBindValue(key);
+            query.addBindValue(value);
+            if (!query.exec()) {
+                qWarning() << "failed to save queue state" << key << query.lastError();
+            }
+        }
+
+        void bindTrack(QSqlQuery& query, const QueueTrack& track)
+        {
+            query.addBindValue(track.filePath);
+            query.addBindValue(track.modificationTime);
+            query.addBindValue(track.title);
+            query.addBindValue(track.artist);
+            query.addBindValue(track.album);
+            query.addBindValue(track.duration);
+            query.addBindValue(track.mediaArtFilePath);
+            query.addBindValue(track.mediaArtKey);
+            query.addBindValue(track.mediaArtOffset);
+            query.addBindValue(track.mediaArtLength);
+        }
+    }
+
+    QueueStore::QueueStore(Queue* queue, QObject* parent)
+        : QObject(parent),
+          mQueue(queue),
+          mStale(true),
+          mTrackIds(queue->trackIds())
+    {
+        mThreadPool.setMaxThreadCount(1);
+        // Keep thread and its connection alive
+        mThreadPool.setExpiryTimeout(-1);
+
+        QObject::connect(queue, &Queue::tracksAdded, this, [=](int start) {
+            const QVector<std::shared_ptr<QueueTrack>>& tracks = mQueue->tracks();
+            if (start >= tracks.size()) {
+                return;
+            }
+
+            const QVector<int> ids(mQueue->trackIds().mid(start));
+            mTrackIds += ids;
+
+            // Tracks are modified in GUI thread, store thread gets copies
+            std::vector<QueueTrack> added;
+            added.reserve(tracks.size() - start);
+            for (int i = start, max = tracks.size(); i < max; ++i) {
+                added.push_back(*tracks.at(i));
+            }
+
+            write([ids, added]() {
+                QSqlDatabase db(database());
+                db.transaction();
+                QSqlQuery query(db);
+                query.prepare(QStringLiteral("INSERT INTO tracks (filePath, modificationTime, title, artist, album, duration, "
+                                             "mediaArtFilePath, mediaArtKey, mediaArtOffset, mediaArtLength, id) "
+                                             "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"));
+                for (int i = 0, max = ids.size(); i < max; ++i) {
+                    bindTrack(query, added[i]);
+                    query.addBindValue(ids.at(i));
+                    if (!query.exec()) {
+                        qWarning() << "failed to save queue track" << query.lastError();
+                    }
+                }
+                db.commit();
+            });
+        });
+
+        QObject::connect(queue, &Queue::tracksRemoved, this, [=](int first, int last) {
+            // Tracks are stored in queue order, so range of queue is a range of ids
+            const int firstId = mTrackIds.at(first);
+            const int lastId = mTrackIds.at(last);
+            mTrackIds.remove(first, last - first + 1);
+
+            write([firstId, lastId]() {
+                QSqlQuery query(database());
+                query.prepare(QStringLiteral("DELETE FROM tracks WHERE id BETWEEN ? AND ?"));
+                query.addBindValue(firstId);
+                query.addBindValue(lastId);
+                if (!query.exec()) {
+                    qWarning() << "failed to remove queue tracks" << query.lastError();
+                }
+            });
+        });
+
+        QObject::connect(queue, &Queue::tracksUpdated, this, [=](const QVector<int>& indexes) {
+            QVector<int> ids;
+            std::vector<QueueTrack> updated;
+            ids.reserve(indexes.size());
+            updated.reserve(indexes.size());
+            for (int index : indexes) {
+                ids.append(mTrackIds.at(index));
+                updated.push_back(*mQueue->tracks().at(index));
+            }
+
+            write([ids, updated]() {
+                QSqlDatabase db(database());
+                db.transaction();
+                QSqlQuery query(db);
+                query.prepare(QStringLiteral("UPDATE tracks SET filePath = ?, modificationTime = ?, title = ?, artist = ?, album = ?, duration = ?, "
+                                             "mediaArtFilePath = ?, mediaArtKey = ?, mediaArtOffset = ?, mediaArtLength = ? "
+                                             "WHERE id = ?"));
+                for (int i = 0, max = ids.size(); i < max; ++i) {
+                    bindTrack(query, updated[i]);
+                    query.addBindValue(ids.at(i));
+                    if (!query.exec()) {
+                        qWarning() << "failed to update queue track" << query.lastError();
+                    }
+                }
+                db.commit();
+            });
+        });
+
+        QObject::connect(queue, &Queue::cleared, this, [=]() {
+            mTrackIds.clear();
+
+            write([]() {
+                QSqlQuery query(database());
+                if (!query.exec(QLatin1String("DELETE FROM tracks"))) {
+                    qWarning() << "failed to clear queue" << query.lastError();
+                }
+                // Give free pages back
+                if (!query.exec(QLatin1String("PRAGMA incremental_vacuum"))) {
+                    qWarning() << "failed to vacuum queue database" << query.lastError();
+                }
+            });
+        });
+
+        QObject::connect(queue, &Queue::currentIndexChanged, this, [=]() {
+            const int index = mQueue->currentIndex();
+            write([index]() {
+                setState(currentIndexKey, index);
+            });
+        });
+    }
+
+    QueueStore::~QueueStore()
+    {
+        mThreadPool.waitForDone();
+    }
+
+    QueueStore::State QueueStore::loadState()
+    {
+        // Queue is restored from what is stored
+        mStale = false;
+
+        return QtConcurrent::run(&mThreadPool, []() {
+            State state;
+            QSqlQuery query(database());
+            if (!query.exec(QLatin1String("SELECT key, value FROM state"))) {
+                qWarning() << "failed to load queue state" << query.lastError();
+                return state;
+            }
+            while (query.next()) {
+                const QString key(query.value(0).toString());
+                if (key == currentIndexKey) {
+                    state.saved = true;
+                    state.currentIndex = query.value(1).toInt();
+                } else if (key == positionKey) {
+                    state.position = query.value(1).toLongLong();
+                } else if (key == shuffleOrderKey) {
+                    const QByteArray order(query.value(1).toByteArray());
+                    state.shuffleOrder.resize(order.size() / static_cast<int>(sizeof(int)));
+                    std::copy(order.constData(),
+                              order.constData() + state.shuffleOrder.size() * static_cast<int>(sizeof(int)),
+                              reinterpret_cast<char*>(state.shuffleOrder.data()));
+                } else if (key == shuffleIndexKey) {
+                    state.shuffleIndex = query.value(1).toInt();
+                }
+            }
+            return state;
+        }).result();
+    }
+
+    QFuture<QVector<std::shared_ptr<QueueTrack>>> QueueStore::loadTracks()
+    {
+        return QtConcurrent::run(&mThreadPool, []() {
+            QVector<std::shared_ptr<QueueTrack>> tracks;
+            QSqlQuery query(database());
+            query.setForwardOnly(true);
+            if (!query.exec(QLatin1String("SELECT filePath, modificationTime, title, artist, album, duration, "
+                                          "mediaArtFilePath, mediaArtKey, mediaArtOffset, mediaArtLength "
+                                          "FROM tracks ORDER BY id"))) {
+                qWarning() << "failed to load queue tracks" << query.lastError();
+                return tracks;
+            }
+            while (query.next()) {
+                tracks.append(std::make_shared<QueueTrack>(query.value(0).toString(),
+                                                           query.value(1).toLongLong(),
+                                                           query.value(2).toString(),
+                                                           query.value(5).toInt(),
+                                                           query.value(3).toString(),
+                                                           query.value(4).toString(),
+                                                           query.value(6).toString(),
+                                                           query.value(7).toByteArray(),
+                                                           query.value(8).toLongLong(),
+                                                           query.value(9).toLongLong()));
+            }
+            return tracks;
+        });
+    }
+
+    void QueueStore::savePosition(long long position)
+    {
+        write([position]() {
+            setState(positionKey, position);
+        });
+    }
+
+    void QueueStore::saveShuffleOrder(const QVector<int>& order, int index)
+    {
+        write([order, index]() {
+            QSqlDatabase db(database());
+            db.transaction();
+            setState(shuffleOrderKey, QByteArray(reinterpret_cast<const char*>(order.constData()),
+                                                 order.size() * static_cast<int>(sizeof(int))));
+            setState(shuffleIndexKey, index);
+            db.commit();
+        });
+    }
+
+    void QueueStore::write(const std::function<void()>& function)
+    {
+        if (mStale) {
+            mStale = false;
+            QtConcurrent::run(&mThreadPool, []() {
+                QSqlDatabase db(database());
+                db.transaction();
+                QSqlQuery query(db);
+                for (const QLatin1String& table : {QLatin1String("tracks"), QLatin1String("state")}) {
+                    if (!query.exec(QString::fromLatin1("DELETE FROM %1").arg(table))) {
+                        qWarning() << "failed to remove previous queue" << query.lastError();
+                    }
+                }
+                db.commit();
+            });
+        }
+        QtConcurrent::run(&mThreadPool, function);
+    }
+}
@@ -0,0 +1,78 @@
+/*
+ * Unplayer
+ * Copyright (C) 2015-2017 Alexey Rochev <equeim@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UNPLAYER_QUEUESTORE_H
+#define UNPLAYER_QUEUESTORE_H
+
+#include <functional>
+#include <memory>
+
+#include <QFuture>
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+namespace unplayer
+{
+    class Queue;
+    struct QueueTrack;
+
+    // Queue state in SQLite database. Changes of queue are recorded as they happen,
+    // and written in order in a separate thread. Tracks are stored with their metadata,
+    // so that queue can be restored without reading it again
+    class QueueStore : public QObject
+    {
+        Q_OBJECT
+    public:
+        struct State
+        {
+            // False if queue was not saved yet
+            bool saved = false;
+            int currentIndex = -1;
+            long long position = 0;
+            QVector<int> shuffleOrder;
+            int shuffleIndex = -1;
+        };
+
+        explicit QueueStore(Queue* queue, QObject* parent = nullptr);
+        // Waits until everything is written
+        ~QueueStore() override;
+
+        State loadState();
+        // Read after changes that were recorded before
+        QFuture<QVector<std::shared_ptr<QueueTrack>>> loadTracks();
+
+        void savePosition(long long position);
+        void saveShuffleOrder(const QVector<int>& order, int index);
+
+    private:
+        void write(const std::function<void()>& function);
+
+        const Queue* mQueue;
+        // Database still has queue of previous session that is not being restored,
+        // it is removed before anything else is written
+        bool mStale;
+        // Ids of queue tracks, mirrored to know what to remove from database
+        QVector<int> mTrackIds;
+        // Single thread, so that changes are written in the same order
+        QThreadPool mThreadPool;
+    };
+}
+
+#endif // UNPLAYER_QUEUESTORE_H
@@ -32,7 +32,9 @@ namespace unplayer
         const QString openLibraryOnStartupKey(QLatin1String("openLibraryOnStartup"));
         const QString defaultDirectoryKey(QLatin1String("defaultDirectory"));
         const QString useDirectoryMediaArtKey(QLatin1String("useDirectoryMediaArt"));
+        const QString accurateDurationKey(QLatin1String("accurateDuration"));
         const QString restorePlayerStateKey(QLatin1String("restorePlayerState"));
+        const QString queueMediaArtCacheSizeKey(QLatin1String("queueMediaArtCacheSize"));
 
         const QString artistsSortDescendingKey(QLatin1String("artistsSortDescending"));
 
@@ -118,6 +120,21 @@ namespace unplayer
         mSettings->setValue(useDirectoryMediaArtKey, use);
     }
 
+    bool Settings::accurateDuration() const
+    {
+        return mSettings->value(accurateDurationKey, true).toBool();
+    }
+
+    void Settings::setAccurateDuration(bool accurate)
+    {
+        mSettings->setValue(accurateDurationKey, accurate);
+    }
+
+    int Settings::queueMediaArtCacheSize() const
+    {
+        return mSettings->value(queueMediaArtCacheSizeKey, 32 * 1024 * 1024).toInt();
+    }
+
     bool Settings::restorePlayerState() const
     {
         return mSettings->value(restorePlayerStateKey, true).toBool();
@@ -265,13 +282,13 @@ namespace unplayer
         return mSettings->value(playerPositionKey).toLongLong();
     }
 
-    void Settings::savePlayerState(const QStringList& tracks, int queuePosition, bool shuffle, int repeatMode, long long playerPosition)
+    void Settings::savePlayerState(bool shuffle, int repeatMode)
     {
-        mSettings->setValue(queueTracksKey, tracks);
-        mSettings->setValue(queuePositionKey, queuePosition);
         mSettings->setValue(shuffleKey, shuffle);
         mSettings->setValue(repeatModeKey, repeatMode);
-        mSettings->setValue(playerPositionKey, playerPosition);
+        mSettings->remove(queueTracksKey);
+        mSettings->remove(queuePositionKey);
+        mSettings->remove(playerPositionKey);
     }
 
     Settings::Settings(QObject* parent)
@@ -32,6 +32,7 @@ namespace unplayer
         Q_PROPERTY(bool openLibraryOnStartup READ openLibraryOnStartup WRITE setOpenLibraryOnStartup)
         Q_PROPERTY(QString defaultDirectory READ defaultDirectory WRITE setDefaultDirectory)
         Q_PROPERTY(bool useDirectoryMediaArt READ useDirectoryMediaArt WRITE setUseDirectoryMediaArt)
+        Q_PROPERTY(bool accurateDuration READ accurateDuration WRITE setAccurateDuration)
         Q_PROPERTY(bool restorePlayerState READ restorePlayerState WRITE setRestorePlayerState)
     public:
         static Settings* instance();
@@ -50,9 +51,15 @@ namespace unplayer
         bool useDirectoryMediaArt() const;
         void setUseDirectoryMediaArt(bool use);
 
+        bool accurateDuration() const;
+        void setAccurateDuration(bool accurate);
+
         bool restorePlayerState() const;
         void setRestorePlayerState(bool restore);
 
+        // In bytes
+        int queueMediaArtCacheSize() const;
+
         bool artistsSortDescending() const;
         void setArtistsSortDescending(bool descending);
 
@@ -81,12 +88,15 @@ namespace unplayer
         bool genresSortDescending() const;
         void setGenresSortDescending(bool descending);
 
-        QStringList queueTracks() const;
-        int queuePosition() const;
         bool shuffle() const;
         int repeatMode() const;
+        // Removes queue saved by previous versions
+        void savePlayerState(bool shuffle, int repeatMode);
+
+        // Queue saved by previous versions, now it is in QueueStore
+        QStringList queueTracks() const;
+        int queuePosition() const;
         long long playerPosition() const;
-        void savePlayerState(const QStringList& tracks, int queuePosition, bool shuffle, int repeatMode, long long playerPosition);
     private:
         explicit Settings(QObject* parent);
 
@@ -18,14 +18,23 @@
 
 #include "tagutils.h"
 
+#include <algorithm>
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QFile>
 #include <QFileInfo>
+#include <QMimeDatabase>
 
 #include <apefile.h>
 #include <apetag.h>
 #include <attachedpictureframe.h>
 #include <fileref.h>
 #include <flacfile.h>
+#include <id3v2frame.h>
+#include <id3v2header.h>
 #include <id3v2tag.h>
+#include <mp4atom.h>
 #include <mp4file.h>
 #include <mpegfile.h>
 #include <oggflacfile.h>
@@ -75,172 +84,364 @@ namespace unplayer
                 }
             }
 
-            void setMediaArt(const TagLib::ByteVector& data, Info& info)
+            enum class MediaArtMode
+            {
+                Skip,
+                Locate,
+                Extract
+            };
+
+            struct MediaArt
             {
-                info.mediaArtData = QByteArray(data.data(), data.size());
+                TagLib::ByteVector data;
+                // Picture data is stored in the file byte for byte
+                bool verbatim = true;
+                // Where picture data is stored, if format tells it.
+                // In that case data is not read in Locate mode
+                long offset = -1;
+                unsigned int length = 0;
+            };
+
+            const unsigned int mediaArtPatternSize = 64;
+
+            void setMediaArt(TagLib::File& file, const MediaArt& mediaArt, bool searchFromEnd, Info& info)
+            {
+                long offset = mediaArt.offset;
+                unsigned int length = mediaArt.length;
+                // First and last bytes of picture
+                TagLib::ByteVector head;
+                TagLib::ByteVector tail;
+
+                if (offset >= 0) {
+                    if (length == 0) {
+                        return;
+                    }
+                    const unsigned int patternSize = std::min(mediaArtPatternSize, length);
+                    file.seek(offset);
+                    head = file.readBlock(patternSize);
+                    file.seek(offset + static_cast<long>(length - patternSize));
+                    tail = file.readBlock(patternSize);
+                    if (head.size() != patternSize || tail.size() != patternSize) {
+                        return;
+                    }
+                } else {
+                    const TagLib::ByteVector& data = mediaArt.data;
+                    if (data.isEmpty()) {
+                        return;
+                    }
+                    length = data.size();
+                    const unsigned int patternSize = std::min(mediaArtPatternSize, length);
+                    head = data.mid(0, patternSize);
+                    tail = data.mid(length - patternSize);
+
+                    if (mediaArt.verbatim) {
+                        // Format does not tell where the picture is stored, so look for its first bytes
+                        // and check that the last ones match too
+                        offset = searchFromEnd ? file.rfind(head) : file.find(head);
+                        if (offset >= 0) {
+                            file.seek(offset + static_cast<long>(length - patternSize));
+                            if (file.readBlock(patternSize) != tail) {
+                                offset = -1;
+                            }
+                        }
+                    }
+                }
+
+                const QMimeType mimeType(QMimeDatabase().mimeTypeForData(QByteArray::fromRawData(head.data(), head.size())));
+                if (!mimeType.name().startsWith(QLatin1String("image/"))) {
+                    return;
+                }
+
+                info.hasMediaArt = true;
+                info.mediaArtOffset = offset;
+                info.mediaArtLength = length;
+                info.mediaArtMimeType = mimeType.name();
+
+                QCryptographicHash hash(QCryptographicHash::Md5);
+                if (offset < 0 && !mediaArt.verbatim) {
+                    hash.addData(mediaArt.data.data(), mediaArt.data.size());
+                } else {
+                    hash.addData(QByteArray::number(length));
+                    hash.addData(head.data(), head.size());
+                    hash.addData(tail.data(), tail.size());
+                }
+                info.mediaArtKey = hash.result();
             }
 
-            void getFlacMediaArt(TagLib::FLAC::File& file, Info& info)
+            MediaArt getFlacMediaArt(TagLib::FLAC::File& file, MediaArtMode mode)
             {
+                MediaArt mediaArt;
+                if (mode == MediaArtMode::Locate && file.firstPictureDataLocation(mediaArt.offset, mediaArt.length)) {
+                    return mediaArt;
+                }
                 const TagLib::List<TagLib::FLAC::Picture*> pictures(file.pictureList());
                 if (!pictures.isEmpty()) {
-                    setMediaArt(pictures.front()->data(), info);
+                    mediaArt.data = pictures.front()->data();
                 }
+                return mediaArt;
             }
 
-            void getApeMediaArt(const TagLib::APE::Tag* tag, Info& info)
+            MediaArt getApeMediaArt(const TagLib::APE::Tag* tag)
             {
+                MediaArt mediaArt;
                 if (!tag) {
-                    return;
+                    return mediaArt;
                 }
 
                 const TagLib::APE::ItemListMap items(tag->itemListMap());
 
                 if (items.contains("COVER ART (FRONT)")) {
                     const TagLib::APE::Item item(items["COVER ART (FRONT)"]);
-                    TagLib::ByteVector data(item.binaryData());
-                    data = data.mid(data.find('\0') + 1);
-                    setMediaArt(data, info);
+                    const TagLib::ByteVector data(item.binaryData());
+                    mediaArt.data = data.mid(data.find('\0') + 1);
                 }
+                return mediaArt;
             }
 
-            void getMp4MediaArt(const TagLib::MP4::Tag* tag, Info& info)
+            MediaArt getMp4MediaArt(TagLib::MP4::File& file, MediaArtMode mode)
             {
+                MediaArt mediaArt;
+                const TagLib::MP4::Tag* tag = file.tag();
                 if (!tag) {
-                    return;
+                    return mediaArt;
+                }
+
+                if (mode == MediaArtMode::Locate) {
+                    // First picture follows covr atom header and header of its data atom
+                    // (size, name, flags and reserved field). Only headers of atoms
+                    // on the path to ilst are read to find it
+                    TagLib::MP4::Atoms atoms(&file);
+                    TagLib::MP4::Atom* ilst = atoms.find("moov", "udta", "meta", "ilst");
+                    const TagLib::MP4::Atom* covr = ilst ? ilst->find("covr") : nullptr;
+                    if (covr) {
+                        file.seek(covr->offset + 8);
+                        const TagLib::ByteVector header(file.readBlock(16));
+                        const unsigned int size = header.toUInt(0U);
+                        if (header.size() == 16 &&
+                                header.mid(4, 4) == "data" &&
+                                size > 16 &&
+                                covr->offset + 8 + static_cast<long>(size) <= covr->offset + covr->length) {
+                            mediaArt.offset = covr->offset + 8 + 16;
+                            mediaArt.length = size - 16;
+                        }
+                    }
+                    return mediaArt;
                 }
 
                 const TagLib::MP4::Item coverItem(tag->item("covr"));
                 if (coverItem.isValid()) {
                     const TagLib::MP4::CoverArtList covers(coverItem.toCoverArtList());
                     if (!covers.isEmpty()) {
-                        setMediaArt(covers.front().data(), info);
+                        mediaArt.data = covers.front().data();
                     }
                 }
+                return mediaArt;
             }
 
-            void getId3v2MediaArt(const TagLib::ID3v2::Tag* tag, Info& info)
+            MediaArt getId3v2MediaArt(const TagLib::ID3v2::Tag* tag)
             {
+                MediaArt mediaArt;
                 if (!tag) {
-                    return;
+                    return mediaArt;
                 }
 
+                const TagLib::ID3v2::Frame* frame = nullptr;
                 const TagLib::ID3v2::FrameList picFrames(tag->frameList("PIC"));
                 if (picFrames.isEmpty()) {
                     const TagLib::ID3v2::FrameList apicFrames(tag->frameList("APIC"));
                     if (!apicFrames.isEmpty()) {
-                        setMediaArt(static_cast<const TagLib::ID3v2::AttachedPictureFrame*>(apicFrames.front())->picture(), info);
+                        frame = apicFrames.front();
+                        mediaArt.data = static_cast<const TagLib::ID3v2::AttachedPictureFrame*>(frame)->picture();
                     }
                 } else {
-                    setMediaArt(static_cast<const TagLib::ID3v2::AttachedPictureFrameV22*>(picFrames.front())->picture(), info);
+                    frame = picFrames.front();
+                    mediaArt.data = static_cast<const TagLib::ID3v2::AttachedPictureFrameV22*>(frame)->picture();
+                }
+
+                if (frame) {
+                    mediaArt.verbatim = !(tag->header()->unsynchronisation() ||
+                                          frame->header()->unsynchronisation() ||
+                                          frame->header()->compression() ||
+                                          frame->header()->encryption());
                 }
+
+                return mediaArt;
             }
 
-            void getXiphMediaArt(TagLib::Ogg::XiphComment* tag, Info& info)
+            MediaArt getXiphMediaArt(TagLib::Ogg::XiphComment* tag)
             {
+                MediaArt mediaArt;
                 if (!tag) {
-                    return;
+                    return mediaArt;
                 }
 
                 const TagLib::List<TagLib::FLAC::Picture*> pictures(tag->pictureList());
                 if (!pictures.isEmpty()) {
-                    setMediaArt(pictures.front()->data(), info);
+                    mediaArt.data = pictures.front()->data();
                 }
+                // Base64 encoded
+                mediaArt.verbatim = false;
+                return mediaArt;
             }
-        }
-
-        Info getTrackInfo(const QFileInfo& fileInfo, const QString& mimeType)
-        {
-            Info info;
 
-            switch (mimeTypeFromString(mimeType)) {
-            case MimeType::Flac:
+            void processMediaArt(TagLib::File& file, const MediaArt& mediaArt, bool searchFromEnd, MediaArtMode mode, Info& info, QByteArray& data)
             {
-                TagLib::FLAC::File file(fileInfo.filePath().toUtf8().data());
-                getAudioProperties(file, info);
-                if (file.hasID3v2Tag()) {
-                    getTags(file.ID3v2Tag(), file.ID3v2Tag()->properties(), info);
-                } else if (file.hasXiphComment()) {
-                    getTags(file.xiphComment(), file.xiphComment()->properties(), info);
-                }
-                getFlacMediaArt(file, info);
-                break;
-            }
-            case MimeType::Mp4:
-            case MimeType::Mp4b:
-            {
-                const TagLib::MP4::File file(fileInfo.filePath().toUtf8().data());
-                getAudioProperties(file, info);
-                if (file.hasMP4Tag()) {
-                    getTags(file.tag(), file.tag()->properties(), info);
-                    getMp4MediaArt(file.tag(), info);
+                switch (mode) {
+                case MediaArtMode::Skip:
+                    break;
+                case MediaArtMode::Locate:
+                    setMediaArt(file, mediaArt, searchFromEnd, info);
+                    break;
+                case MediaArtMode::Extract:
+                    data = QByteArray(mediaArt.data.data(), mediaArt.data.size());
                 }
-                break;
-            }
-            case MimeType::Mpeg:
-            {
-                TagLib::MPEG::File file(fileInfo.filePath().toUtf8().data());
-                getAudioProperties(file, info);
-                if (file.hasAPETag()) {
-                    getTags(file.APETag(), file.APETag()->properties(), info);
-                    getApeMediaArt(file.APETag(), info);
-                } else if (file.hasID3v2Tag()) {
-                    getId3v2MediaArt(file.ID3v2Tag(), info);
-                    getTags(file.ID3v2Tag(), file.ID3v2Tag()->properties(), info);
-                }
-                break;
             }
-            case MimeType::VorbisOgg:
-            {
-                const TagLib::Ogg::Vorbis::File file(fileInfo.filePath().toUtf8().data());
-                getAudioProperties(file, info);
-                getTags(file.tag(), file.tag()->properties(), info);
-                getXiphMediaArt(file.tag(), info);
-                break;
-            }
-            case MimeType::FlacOgg:
-            {
-                const TagLib::Ogg::FLAC::File file(fileInfo.filePath().toUtf8().data());
-                getAudioProperties(file, info);
-                getTags(file.tag(), file.tag()->properties(), info);
-                getXiphMediaArt(file.tag(), info);
-                break;
-            }
-            case MimeType::OpusOgg:
-            {
-                const TagLib::Ogg::Opus::File file(fileInfo.filePath().toUtf8().data());
-                getAudioProperties(file, info);
-                getTags(file.tag(), file.tag()->properties(), info);
-                getXiphMediaArt(file.tag(), info);
-                break;
-            }
-            case MimeType::Ape:
+
+            Info readFile(const QFileInfo& fileInfo, const QString& mimeType, MediaArtMode mediaArtMode, QByteArray& mediaArtData)
             {
-                TagLib::APE::File file(fileInfo.filePath().toUtf8().data());
-                getAudioProperties(file, info);
-                if (file.hasAPETag()) {
-                    getApeMediaArt(file.APETag(), info);
-                    getTags(file.APETag(), file.APETag()->properties(), info);
+                Info info;
+                const bool mediaArt = (mediaArtMode != MediaArtMode::Skip);
+
+                switch (mimeTypeFromString(mimeType)) {
+                case MimeType::Flac:
+                {
+                    TagLib::FLAC::File file(fileInfo.filePath().toUtf8().data());
+                    getAudioProperties(file, info);
+                    if (file.hasID3v2Tag()) {
+                        getTags(file.ID3v2Tag(), file.ID3v2Tag()->properties(), info);
+                    } else if (file.hasXiphComment()) {
+                        getTags(file.xiphComment(), file.xiphComment()->properties(), info);
+                    }
+                    if (mediaArt) {
+                        processMediaArt(file, getFlacMediaArt(file, mediaArtMode), false, mediaArtMode, info, mediaArtData);
+                    }
+                    break;
                 }
-                break;
-            }
-            default:
-            {
-                const TagLib::FileRef file(fileInfo.filePath().toUtf8().data());
-                if (file.file()) {
-                    getAudioProperties(*file.file(), info);
-                    if (file.tag()) {
+                case MimeType::Mp4:
+                case MimeType::Mp4b:
+                {
+                    TagLib::MP4::File file(fileInfo.filePath().toUtf8().data());
+                    getAudioProperties(file, info);
+                    if (file.hasMP4Tag()) {
                         getTags(file.tag(), file.tag()->properties(), info);
+                        if (mediaArt) {
+                            processMediaArt(file, getMp4MediaArt(file, mediaArtMode), false, mediaArtMode, info, mediaArtData);
+                        }
                     }
+                    break;
                 }
+                case MimeType::Mpeg:
+                {
+                    TagLib::MPEG::File file(fileInfo.filePath().toUtf8().data());
+                    getAudioProperties(file, info);
+                    info.durationEstimated = (file.audioProperties() && !file.audioProperties()->xingHeader());
+                    if (file.hasAPETag()) {
+                        getTags(file.APETag(), file.APETag()->properties(), info);
+                        if (mediaArt) {
+                            processMediaArt(file, getApeMediaArt(file.APETag()), true, mediaArtMode, info, mediaArtData);
+                        }
+                    } else if (file.hasID3v2Tag()) {
+                        if (mediaArt) {
+                            processMediaArt(file, getId3v2MediaArt(file.ID3v2Tag()), false, mediaArtMode, info, mediaArtData);
+                        }
+                        getTags(file.ID3v2Tag(), file.ID3v2Tag()->properties(), info);
+                    }
+                    break;
+                }
+                case MimeType::VorbisOgg:
+                {
+                    TagLib::Ogg::Vorbis::File file(fileInfo.filePath().toUtf8().data());
+                    getAudioProperties(file, info);
+                    getTags(file.tag(), file.tag()->properties(), info);
+                    if (mediaArt) {
+                        processMediaArt(file, getXiphMediaArt(file.tag()), false, mediaArtMode, info, mediaArtData);
+                    }
+                    break;
+                }
+                case MimeType::FlacOgg:
+                {
+                    TagLib::Ogg::FLAC::File file(fileInfo.filePath().toUtf8().data());
+                    getAudioProperties(file, info);
+                    getTags(file.tag(), file.tag()->properties(), info);
+                    if (mediaArt) {
+                        processMediaArt(file, getXiphMediaArt(file.tag()), false, mediaArtMode, info, mediaArtData);
+                    }
+                    break;
+                }
+                case MimeType::OpusOgg:
+                {
+                    TagLib::Ogg::Opus::File file(fileInfo.filePath().toUtf8().data());
+                    getAudioProperties(file, info);
+                    getTags(file.tag(), file.tag()->properties(), info);
+                    if (mediaArt) {
+                        processMediaArt(file, getXiphMediaArt(file.tag()), false, mediaArtMode, info, mediaArtData);
+                    }
+                    break;
+                }
+                case MimeType::Ape:
+                {
+                    TagLib::APE::File file(fileInfo.filePath().toUtf8().data());
+                    getAudioProperties(file, info);
+                    if (file.hasAPETag()) {
+                        if (mediaArt) {
+                            processMediaArt(file, getApeMediaArt(file.APETag()), true, mediaArtMode, info, mediaArtData);
+                        }
+                        getTags(file.APETag(), file.APETag()->properties(), info);
+                    }
+                    break;
+                }
+                default:
+                {
+                    const TagLib::FileRef file(fileInfo.filePath().toUtf8().data());
+                    if (file.file()) {
+                        getAudioProperties(*file.file(), info);
+                        if (file.tag()) {
+                            getTags(file.tag(), file.tag()->properties(), info);
+                        }
+                    }
+                }
+                }
+
+                if (info.title.isEmpty()) {
+                    info.title = fileInfo.fileName();
+                }
+
+                return info;
             }
-            }
+        }
 
-            if (info.title.isEmpty()) {
-                info.title = fileInfo.fileName();
+        Info getTrackInfo(const QFileInfo& fileInfo, const QString& mimeType, bool mediaArt)
+        {
+            QByteArray mediaArtData;
+            return readFile(fileInfo, mimeType, mediaArt ? MediaArtMode::Locate : MediaArtMode::Skip, mediaArtData);
+        }
+
+        QByteArray getMediaArtData(const QString& filePath, long long offset, long long length)
+        {
+            if (offset >= 0) {
+                QFile file(filePath);
+                if (!file.open(QIODevice::ReadOnly) || !file.seek(offset)) {
+                    qWarning() << "failed to read media art from file:" << filePath;
+                    return QByteArray();
+                }
+                return file.read(length);
             }
 
-            return info;
+            QByteArray mediaArtData;
+            readFile(QFileInfo(filePath),
+                     QMimeDatabase().mimeTypeForFile(filePath, QMimeDatabase::MatchContent).name(),
+                     MediaArtMode::Extract,
+                     mediaArtData);
+            return mediaArtData;
+        }
+
+        int getAccurateMpegDuration(const QString& filePath)
+        {
+            const TagLib::MPEG::File file(filePath.toUtf8().data(), true, TagLib::AudioProperties::Accurate);
+            if (file.audioProperties()) {
+                return file.audioProperties()->length();
+            }
+            return 0;
         }
     }
 }
@@ -19,8 +19,8 @@
 #ifndef UNPLAYER_TAGUTILS_H
 #define UNPLAYER_TAGUTILS_H
 
+#include <QByteArray>
 #include <QString>
-#include <QPixmap>
 
 #include "libraryutils.h"
 
@@ -40,10 +40,27 @@ namespace unplayer
             QStringList genres;
             int duration = 0;
             int bitrate = 0;
-            QByteArray mediaArtData;
+            // Duration of MPEG file without VBR header is estimated from a few
+            // frames, getAccurateMpegDuration() walks through all of them
+            bool durationEstimated = false;
+
+            // Embedded media art is not copied, only its location is reported.
+            // mediaArtOffset is -1 if picture is not stored in the file as is
+            // (e.g. base64 encoded in Vorbis comments), in that case it can only
+            // be extracted using TagLib
+            bool hasMediaArt = false;
+            long long mediaArtOffset = -1;
+            long long mediaArtLength = 0;
+            // Detected from first bytes of picture
+            QString mediaArtMimeType;
+            // Identifies picture without reading all of it (hash of its length
+            // and first and last bytes), tracks with the same picture have the same key
+            QByteArray mediaArtKey;
         };
 
-        Info getTrackInfo(const QFileInfo& fileInfo, const QString& mimeType);
+        Info getTrackInfo(const QFileInfo& fileInfo, const QString& mimeType, bool mediaArt = true);
+        QByteArray getMediaArtData(const QString& filePath, long long offset, long long length);
+        int getAccurateMpegDuration(const QString& filePath);
     }
 }
 
@@ -39,7 +39,7 @@ namespace unplayer
 
         const QFileInfo fileInfo(mFilePath);
 
-        const tagutils::Info info(tagutils::getTrackInfo(fileInfo, mMimeType));
+        const tagutils::Info info(tagutils::getTrackInfo(fileInfo, mMimeType, false));
 
         mTitle = info.title;
         mArtist = info.artists.join(QLatin1String(", "));
@@ -20,10 +20,16 @@
 
 #include <QCoreApplication>
 #include <QDebug>
+#include <QFutureWatcher>
+#include <QRegularExpression>
 #include <QSqlDriver>
 #include <QSqlError>
 #include <QUrl>
+#include <QtConcurrentRun>
 
+#include "libraryutils.h"
+#include "player.h"
+#include "queue.h"
 #include "settings.h"
 
 namespace unplayer
@@ -36,12 +42,22 @@ namespace unplayer
             TitleField,
             ArtistField,
             AlbumField,
-            DurationField
+            DurationField,
+            IdField,
+            MediaArtField
         };
     }
 
     TracksModel::TracksModel()
-        : mAllArtists(true),
+        : DatabaseModel({FieldType::String,
+                         FieldType::String,
+                         FieldType::String,
+                         FieldType::String,
+                         FieldType::Int,
+                         FieldType::Int,
+                         FieldType::String},
+                        {FilePathField, ArtistField, AlbumField}),
+          mAllArtists(true),
           mAllAlbums(true),
           mSortDescending(false),
           mSortMode(SortMode::ArtistAlbumYear),
@@ -89,31 +105,33 @@ namespace unplayer
 
     QVariant TracksModel::data(const QModelIndex& index, int role) const
     {
-        mQuery->seek(index.row());
+        const int row = index.row();
 
         switch (role) {
         case FilePathRole:
-            return mQuery->value(FilePathField);
+            return stringValue(row, FilePathField);
         case TitleRole:
-            return mQuery->value(TitleField);
+            return stringValue(row, TitleField);
         case ArtistRole:
         {
-            const QString artist(mQuery->value(ArtistField).toString());
+            const QString& artist = stringValue(row, ArtistField);
             if (artist.isEmpty()) {
-                return qApp->translate("unplayer", "Unknown artist");
+                static const QString unknownArtist(qApp->translate("unplayer", "Unknown artist"));
+                return unknownArtist;
             }
             return artist;
         }
         case AlbumRole:
         {
-            const QString album(mQuery->value(AlbumField).toString());
+            const QString& album = stringValue(row, AlbumField);
             if (album.isEmpty()) {
-                return qApp->translate("unplayer", "Unknown album");
+                static const QString unknownAlbum(qApp->translate("unplayer", "Unknown album"));
+                return unknownAlbum;
             }
             return album;
         }
         case DurationRole:
-            return mQuery->value(DurationField);
+            return intValue(row, DurationField);
         default:
             return QVariant();
         }
@@ -169,6 +187,19 @@ namespace unplayer
         mGenre = genre;
     }
 
+    const QString& TracksModel::searchQuery() const
+    {
+        return mSearchQuery;
+    }
+
+    void TracksModel::setSearchQuery(const QString& query)
+    {
+        if (query != mSearchQuery) {
+            mSearchQuery = query;
+            setQuery();
+        }
+    }
+
     bool TracksModel::sortDescending() const
     {
         return mSortDescending;
@@ -210,15 +241,44 @@ namespace unplayer
         }
     }
 
-    QStringList TracksModel::getTracks(const QVector<int>& indexes)
+    void TracksModel::getTracks(const QVector<int>& indexes)
     {
-        QStringList tracks;
-        tracks.reserve(indexes.size());
-        for (int index : indexes) {
-            mQuery->seek(index);
-            tracks.append(mQuery->value(FilePathField).toString());
-        }
-        return tracks;
+        const auto getValues(rowsValues(indexes, {FilePathField}));
+        auto future = QtConcurrent::run([getValues]() {
+            const QVector<QVariantList> values(getValues());
+            QStringList tracks;
+            tracks.reserve(values.size());
+            for (const QVariantList& row : values) {
+                tracks.append(row.first().toString());
+            }
+            return tracks;
+        });
+
+        using FutureWatcher = QFutureWatcher<QStringList>;
+        auto watcher = new FutureWatcher(this);
+        QObject::connect(watcher, &FutureWatcher::finished, this, [=]() {
+            emit gotTracks(watcher->result());
+            watcher->deleteLater();
+        });
+        watcher->setFuture(future);
+    }
+
+    void TracksModel::addTracksToQueue(const QVector<int>& indexes, bool clearQueue, int setAsCurrent)
+    {
+        const auto getValues(rowsValues(indexes, {IdField, ArtistField, AlbumField}));
+        Player::instance()->queue()->addLibraryTracks([getValues]() {
+            const QVector<QVariantList> values(getValues());
+            QVector<QStringList> selection;
+            selection.reserve(values.size());
+            for (const QVariantList& row : values) {
+                selection.append({row.at(0).toString(), row.at(1).toString(), row.at(2).toString()});
+            }
+            // Each row matches one track row, which is joined with all artists and albums of track
+            return getLibraryTracks({QLatin1String("id"), QLatin1String("artist"), QLatin1String("album")},
+                                    selection,
+                                    QLatin1String("genreIndex = 0"),
+                                    QString());
+        }, clearQueue, setAsCurrent);
     }
 
     QHash<int, QByteArray> TracksModel::roleNames() const
@@ -232,37 +292,22 @@ namespace unplayer
 
     void TracksModel::setQuery()
     {
-        beginResetModel();
-
-        QString query(QLatin1String("SELECT filePath, title, artist, album, duration FROM tracks "));
-
-        if (mAllArtists) {
-            if (!mGenre.isEmpty()) {
-                query += QLatin1String("WHERE genre = ? ");
-            }
-            query += QLatin1String("GROUP BY id, artist, album ");
-        } else {
-            query += QLatin1String("WHERE artist = ? ");
-            if (mAllAlbums) {
-                query += QLatin1String("GROUP BY id, album ");
-            } else {
-                query += QLatin1String("AND album = ? "
-                                       "GROUP BY id ");
-            }
-        }
-
+        QStringList sortKeys;
         switch (mSortMode) {
         case SortMode::Title:
-            query += QLatin1String("ORDER BY title %1");
+            sortKeys.append(QLatin1String("titleSortKey"));
             break;
         case SortMode::AddedDate:
-            query += QLatin1String("ORDER BY id %1");
+            sortKeys.append(QLatin1String("id"));
             break;
         case SortMode::ArtistAlbumTitle:
-            query += QLatin1String("ORDER BY artist = '' %1, artist %1, album = '' %1, album %1, ");
+            sortKeys << QLatin1String("artistSortKey")
+                     << QLatin1String("albumSortKey");
             break;
         case SortMode::ArtistAlbumYear:
-            query += QLatin1String("ORDER BY artist = '' %1, artist %1, album = '' %1, year %1, album %1, ");
+            sortKeys << QLatin1String("artistSortKey")
+                     << QLatin1String("year")
+                     << QLatin1String("albumSortKey");
             break;
         }
 
@@ -270,32 +315,96 @@ namespace unplayer
                 mSortMode == SortMode::ArtistAlbumYear) {
             switch (mInsideAlbumSortMode) {
             case InsideAlbumSortMode::Title:
-                query += QLatin1String("title %1");
+                sortKeys.append(QLatin1String("titleSortKey"));
                 break;
             case InsideAlbumSortMode::TrackNumber:
-                query += QLatin1String("trackNumber %1, title %1");
+                sortKeys << QLatin1String("trackNumber")
+                         << QLatin1String("titleSortKey");
                 break;
             }
         }
 
-        query = query.arg(mSortDescending ? QLatin1String("DESC")
-                                          : QLatin1String("ASC"));
-
-        mQuery->prepare(query);
+        // One row per (id, artist, album), without GROUP BY so that rows can be read in index order
+        QStringList where;
+        QVariantList bindValues;
+        if (mAllArtists && !mGenre.isEmpty()) {
+            where.append(QLatin1String("genre = ?"));
+            bindValues.append(mGenre);
+        } else {
+            where.append(QLatin1String("genreIndex = 0"));
+        }
+        if (!mAllArtists) {
+            where.append(QLatin1String("artist = ?"));
+            bindValues.append(mArtist);
+            if (!mAllAlbums) {
+                where.append(QLatin1String("album = ?"));
+                bindValues.append(mAlbum);
+            }
+        }
 
-        if (mAllArtists) {
-            if (!mGenre.isEmpty()) {
-                mQuery->addBindValue(mGenre);
+        QString searchJoin;
+        bool searchRank = false;
+        const LibraryUtils* libraryUtils = LibraryUtils::instance();
+        if (libraryUtils->fullTextSearch() == LibraryUtils::FullTextSearch::None) {
+            // No full-text index, scan the table
+            for (QString word : mSearchQuery.split(QRegularExpression(QLatin1String("\\s+")), QString::SkipEmptyParts)) {
+                word.replace(QLatin1Char('\\'), QLatin1String("\\\\"));
+                word.replace(QLatin1Char('%'), QLatin1String("\\%"));
+                word.replace(QLatin1Char('_'), QLatin1String("\\_"));
+                where.append(QLatin1String("(title || ' ' || artist || ' ' || album || ' ' || genre) LIKE ? ESCAPE '\\'"));
+                bindValues.append(QString::fromLatin1("%%1%").arg(word));
             }
         } else {
-            mQuery->addBindValue(mArtist);
-            if (!mAllAlbums) {
-                mQuery->addBindValue(mAlbum);
+            const QString match(libraryUtils->fullTextSearchQuery(mSearchQuery));
+            if (!match.isEmpty()) {
+                if (libraryUtils->fullTextSearch() == LibraryUtils::FullTextSearch::Fts5) {
+                    searchJoin = QLatin1String("JOIN (SELECT rowid AS trackId, rank FROM tracks_search WHERE tracks_search MATCH ?) AS search "
+                                               "ON search.trackId = tracks.id ");
+                    searchRank = true;
+                } else {
+                    searchJoin = QLatin1String("JOIN (SELECT docid AS trackId FROM tracks_search WHERE tracks_search MATCH ?) AS search "
+                                               "ON search.trackId = tracks.id ");
+                }
+                bindValues.prepend(match);
             }
         }
 
-        execQuery();
+        if (mAllArtists && mSearchQuery.trimmed().isEmpty()) {
+            // All tracks can be a lot of rows, load them by pages
+            PagedQuery query;
+            query.fields = QLatin1String("filePath, title, artist, album, duration, id, mediaArt");
+            query.table = QLatin1String("tracks");
+            query.where = where.join(QLatin1String(" AND "));
+            query.bindValues = bindValues;
+
+            // Make each row unique
+            for (const QLatin1String& key : {QLatin1String("id"), QLatin1String("artist"), QLatin1String("album")}) {
+                if (!sortKeys.contains(key)) {
+                    sortKeys.append(key);
+                }
+            }
+            query.sortKeys = sortKeys;
+            query.descending = mSortDescending;
+
+            execPagedQuery(query);
+            return;
+        }
+
+        QString query(QLatin1String("SELECT filePath, title, artist, album, duration, id, mediaArt FROM tracks "));
+        query += searchJoin;
+        if (!where.isEmpty()) {
+            query += QLatin1String("WHERE ") + where.join(QLatin1String(" AND ")) + QLatin1Char(' ');
+        }
+
+        const QString order(mSortDescending ? QLatin1String(" DESC")
+                                            : QLatin1String(" ASC"));
+        query += QLatin1String("ORDER BY ");
+        if (searchRank) {
+            // Best matches first
+            query += QLatin1String("search.rank, ");
+        }
+        query += sortKeys.join(order + QLatin1String(", ")) + order;
 
-        endResetModel();
+        execQuery(query, bindValues);
     }
 }
@@ -60,6 +60,7 @@ namespace unplayer
         Q_PROPERTY(QString artist READ artist WRITE setArtist)
         Q_PROPERTY(QString album READ album WRITE setAlbum)
         Q_PROPERTY(QString genre READ genre WRITE setGenre)
+        Q_PROPERTY(QString searchQuery READ searchQuery WRITE setSearchQuery)
 
         Q_PROPERTY(bool sortDescending READ sortDescending WRITE setSortDescending)
         Q_PROPERTY(unplayer::TracksModelSortMode::Mode sortMode READ sortMode WRITE setSortMode NOTIFY sortModeChanged)
@@ -98,6 +99,9 @@ namespace unplayer
         const QString& genre() const;
         void setGenre(const QString& genre);
 
+        const QString& searchQuery() const;
+        void setSearchQuery(const QString& query);
+
         bool sortDescending() const;
         void setSortDescending(bool descending);
 
@@ -107,19 +111,23 @@ namespace unplayer
         InsideAlbumSortMode insideAlbumSortMode() const;
         void setInsideAlbumSortMode(InsideAlbumSortMode mode);
 
-        Q_INVOKABLE QStringList getTracks(const QVector<int>& indexes);
+        // Pages that are not loaded are read in a worker thread, result is emitted with gotTracks()
+        Q_INVOKABLE void getTracks(const QVector<int>& indexes);
+        // Rows already have everything that queue needs
+        Q_INVOKABLE void addTracksToQueue(const QVector<int>& indexes, bool clearQueue = false, int setAsCurrent = -1);
 
     protected:
         QHash<int, QByteArray> roleNames() const override;
 
     private:
-        void setQuery();
+        void setQuery() override;
 
         bool mAllArtists;
         bool mAllAlbums;
         QString mArtist;
         QString mAlbum;
         QString mGenre;
+        QString mSearchQuery;
 
         bool mSortDescending;
         SortMode mSortMode;
@@ -128,6 +136,7 @@ namespace unplayer
     signals:
         void sortModeChanged();
         void insideAlbumSortModeChanged();
+        void gotTracks(const QStringList& tracks);
     };
 }
 
@@ -25,7 +25,6 @@
 #include <QItemSelection>
 #include <QLocale>
 #include <QMimeDatabase>
-#include <QRegularExpression>
 #include <QStandardPaths>
 #include <QUrl>
 #include <qqml.h>
@@ -183,11 +182,6 @@ namespace unplayer
         return QString();
     }
 
-    QString Utils::escapeRegExp(const QString& string)
-    {
-        return QRegularExpression::escape(string);
-    }
-
     QString Utils::homeDirectory()
     {
         return QStandardPaths::writableLocation(QStandardPaths::HomeLocation);
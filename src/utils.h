@@ -43,8 +43,6 @@ namespace unplayer
         Q_INVOKABLE static QString formatDuration(uint seconds);
         Q_INVOKABLE static QString formatByteSize(double size);
 
-        Q_INVOKABLE static QString escapeRegExp(const QString& string);
-
         static QString homeDirectory();
         static QString sdcardPath(bool emptyIfNotMounted = false);
 
@@ -0,0 +1,101 @@
+/*
+ * Unplayer
+ * Copyright (C) 2015-2017 Alexey Rochev <equeim@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <random>
+
+#include <QCollator>
+#include <QStringListModel>
+#include <QtTest>
+
+#include "filterproxymodel.h"
+
+namespace unplayer
+{
+    namespace
+    {
+        const int filesCount = 20000;
+
+        // Sorts by comparing strings with collator each time, as FilterProxyModel did before sort keys were cached
+        class CollatorCompareProxyModel : public FilterProxyModel
+        {
+        public:
+            CollatorCompareProxyModel()
+            {
+                mCollator.setNumericMode(true);
+            }
+
+        protected:
+            bool lessThan(const QModelIndex& left, const QModelIndex& right) const override
+            {
+                return (mCollator.compare(left.data(sortRole()).toString(), right.data(sortRole()).toString()) < 0);
+            }
+
+        private:
+            QCollator mCollator;
+        };
+    }
+
+    class FilterProxyModelBenchmark : public QObject
+    {
+        Q_OBJECT
+    private slots:
+        void initTestCase()
+        {
+            // File names like in a music directory, with a fixed seed so that runs are comparable
+            static const char* const words[] = {"Album", "Live", "Night", "Über", "Café", "Blue", "Song", "Élan", "River", "Åsa"};
+            std::mt19937 generator(42);
+            std::uniform_int_distribution<int> word(0, 9);
+            std::uniform_int_distribution<int> number(1, 30);
+
+            QStringList files;
+            files.reserve(filesCount);
+            for (int i = 0; i < filesCount; ++i) {
+                files.append(QString::fromLatin1("%1 %2 - %3 %4.flac").arg(QString::fromUtf8(words[word(generator)]))
+                                                                     .arg(number(generator))
+                                                                     .arg(QString::fromUtf8(words[word(generator)]))
+                                                                     .arg(i));
+            }
+            mSourceModel.setStringList(files);
+        }
+
+        void sortCollatorCompare()
+        {
+            QBENCHMARK {
+                CollatorCompareProxyModel model;
+                model.setSourceModel(&mSourceModel);
+                model.sort(0);
+            }
+        }
+
+        void sortCachedKeys()
+        {
+            QBENCHMARK {
+                FilterProxyModel model;
+                model.setSourceModel(&mSourceModel);
+                model.sort(0);
+            }
+        }
+
+    private:
+        QStringListModel mSourceModel;
+    };
+}
+
+QTEST_GUILESS_MAIN(unplayer::FilterProxyModelBenchmark)
+
+#include "filterproxymodelbenchmark.moc"